@@ -0,0 +1,322 @@
+/**
+  @file board.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Simulated UCFK4 boards for the host harness, and host versions of the drivers the
+         game uses. The drivers act on the board running on the thread, and a board hands
+         the thread over to the next each time it waits on the pacer.
+ */
+
+#include <stdlib.h>
+#include <ucontext.h>
+#include "system.h"
+#include "pacer.h"
+#include "timer.h"
+#include "tinygl.h"
+#include "navswitch.h"
+#include "ir_serial.h"
+#include "game.h"
+#include "board.h"
+
+// How long the bot holds a button for a push, and for a long push past LONG_PUSH_TICKS in
+// input.c. Times are in ticks of the game.
+#define BOT_PUSH_TICKS 3
+#define BOT_LONG_PUSH_TICKS 600
+
+// The bot waits at least BOT_IDLE_TICKS between pushes, past the debounce time in input.c,
+// and up to BOT_IDLE_SPREAD ticks more
+#define BOT_IDLE_TICKS 20
+#define BOT_IDLE_SPREAD 40
+
+// The board has no receive buffer, so a byte is lost unless it's polled for soon after it is
+// sent. In scans of the display, as the boards of a pair scan in step. Boards hand over the
+// thread once per tick, so the two may be up to a tick apart.
+#define BOARD_AIR_SCANS (2 * SHADE_SCANS_PER_TICK)
+
+// The board running on this thread, and where it goes back to when it waits on the pacer
+static _Thread_local board_t* board_current;
+static _Thread_local ucontext_t board_scheduler;
+
+static double board_loss;
+
+
+/** Advance the random number generator of a board.
+    @param board The board
+    @return The next random number */
+static uint32_t board_random(board_t* board)
+{
+    uint32_t x = board->bot.random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    board->bot.random = x;
+    return x;
+}
+
+
+/** Run the game of the board this coroutine was started for. Never returns. */
+static void board_run(void)
+{
+    board_t* board = board_current;
+    game_context_t* ctx = &board->game;
+
+    input_init(ctx);
+    board->state = SETUP;
+    while (1) {
+        if (shade_tick(ctx)) {
+            input_frame_started(ctx);
+        }
+        GameState_t next_state = game_step(ctx, board->state);
+        if (next_state == ATTACK && board->state != ATTACK) {
+            // Time the turn cycle as tools/trace_decode.py does, between starts of our turns
+            if (board->turn_start_us) {
+                board->turns_us += board->time_us - board->turn_start_us;
+                board->turns++;
+            }
+            board->turn_start_us = board->time_us;
+        }
+        if ((board->state == WIN || board->state == LOSS) && next_state == SETUP) {
+            // The fleets have been swapped and checked by now
+            board->games++;
+            board->turn_start_us = 0;
+            if (ctx->message.verdict == VERIFY_CHEATED) {
+                board->cheats++;
+            } else if (ctx->message.verdict == VERIFY_UNVERIFIED) {
+                board->unverified++;
+            }
+        }
+        board->state = next_state;
+    }
+}
+
+
+/** Set up a board ready to start its game, with a powered off display and an empty link.
+    @param board The board
+    @param seed Seed for the bot and the link losses of this board
+    @param stack_bytes Size of the stack to run the game on */
+void board_init(board_t* board, uint32_t seed, size_t stack_bytes)
+{
+    *board = (board_t){
+        .game = GAME_CONTEXT_INIT,
+        .state = SETUP,
+        .pacer_period_us = 1000000 / DISPLAY_RATE,
+        .bot = {.random = seed ? seed : 1, .last_state = SETUP}
+    };
+    // Boards are switched on at different times
+    board->time_us = board_random(board) % 1000000;
+
+    board->stack = malloc(stack_bytes);
+    if (!board->stack) {
+        abort();
+    }
+    getcontext(&board->context);
+    board->context.uc_stack.ss_sp = board->stack;
+    board->context.uc_stack.ss_size = stack_bytes;
+    board->context.uc_link = NULL;
+    makecontext(&board->context, board_run, 0);
+}
+
+
+/** Free the stack of a board. */
+void board_free(board_t* board)
+{
+    free(board->stack);
+    board->stack = NULL;
+}
+
+
+/** Pair two boards up, so each receives what the other sends. */
+void board_pair(board_t* a, board_t* b)
+{
+    a->peer = b;
+    b->peer = a;
+}
+
+
+/** Run a board on this thread until its game next waits on the pacer.
+    @param board The board */
+void board_resume(board_t* board)
+{
+    board_current = board;
+    swapcontext(&board_scheduler, &board->context);
+    board_current = NULL;
+}
+
+
+/** Set the chance of each byte sent over IR being lost, shared by every board.
+    @param probability The chance, from 0 to 1 */
+void board_set_loss(double probability)
+{
+    board_loss = probability;
+}
+
+
+void system_init(void)
+{
+}
+
+
+void pacer_init(pacer_rate_t pacer_rate)
+{
+    board_current->pacer_period_us = 1000000 / pacer_rate;
+}
+
+
+/** Wait for the next scan. Once per tick of the game, the other boards on the thread run in
+    the meantime. The link is only polled once a tick's scans are done, so handing over at
+    every scan would triple the switching for nothing. */
+void pacer_wait(void)
+{
+    board_t* board = board_current;
+    board->time_us += board->pacer_period_us;
+    board->scans++;
+    if (board->scans % SHADE_SCANS_PER_TICK == 0) {
+        swapcontext(&board->context, &board_scheduler);
+    }
+}
+
+
+timer_tick_t timer_get(void)
+{
+    return board_current->time_us * TIMER_RATE / 1000000;
+}
+
+
+void tinygl_init(uint16_t update_rate)
+{
+    (void)update_rate;
+}
+
+
+void tinygl_pixel_set(tinygl_point_t point, tinygl_pixel_value_t pixel_value)
+{
+    uint8_t* column = &board_current->pixels[point.x];
+    if (pixel_value) {
+        *column |= 1 << point.y;
+    } else {
+        *column &= ~(1 << point.y);
+    }
+}
+
+
+void tinygl_update(void)
+{
+}
+
+
+/** Push a button of the board, and hold it down for a while.
+    @param board The board
+    @param navswitch The button
+    @param ticks How long to hold it down */
+static void bot_push(board_t* board, uint8_t navswitch, uint16_t ticks)
+{
+    board->buttons_down = 1 << navswitch;
+    board->buttons_pushed = 1 << navswitch;
+    board->bot.hold_ticks = ticks;
+}
+
+
+/** Let the bot play the board's navswitch for a tick. It auto-places the fleet and places
+    the last boat in setup, and pushes at random while attacking. Now and then it skips an
+    outcome part way through. */
+void navswitch_update(void)
+{
+    board_t* board = board_current;
+    board_bot_t* bot = &board->bot;
+
+    board->buttons_pushed = 0;
+    if (board->state == SETUP && bot->last_state != SETUP) {
+        bot->fleet_placed = false;
+    }
+    bot->last_state = board->state;
+
+    if (bot->hold_ticks) {
+        bot->hold_ticks--;
+        if (!bot->hold_ticks) {
+            board->buttons_down = 0;
+        }
+        return;
+    }
+    if (bot->idle_ticks) {
+        bot->idle_ticks--;
+        return;
+    }
+    bot->idle_ticks = BOT_IDLE_TICKS + board_random(board) % BOT_IDLE_SPREAD;
+
+    switch (board->state) {
+        case SETUP:
+            bot_push(board, NAVSWITCH_PUSH, bot->fleet_placed ? BOT_PUSH_TICKS
+                                                               : BOT_LONG_PUSH_TICKS);
+            bot->fleet_placed = true;
+            break;
+        case ATTACK:
+            bot_push(board, board_random(board) % (NAVSWITCH_PUSH + 1), BOT_PUSH_TICKS);
+            break;
+        case HIT:
+        case MISS:
+        case SUNK:
+        case SALVO:
+            if (board_random(board) % 4 == 0) {
+                bot_push(board, NAVSWITCH_PUSH, BOT_PUSH_TICKS);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+bool navswitch_push_event_p(uint8_t navswitch)
+{
+    return (board_current->buttons_pushed >> navswitch) & 1;
+}
+
+
+bool navswitch_down_p(uint8_t navswitch)
+{
+    return (board_current->buttons_down >> navswitch) & 1;
+}
+
+
+void ir_serial_init(void)
+{
+}
+
+
+/** Send a byte to the other board of the pair. It may be lost on the way, or if the other
+    board's receiver is full. */
+void ir_serial_transmit(uint8_t data)
+{
+    board_t* board = board_current;
+    board_t* peer = board->peer;
+
+    board->bytes_sent++;
+    if ((board_random(board) >> 8) < board_loss * (1 << 24) || peer->rx_count == BOARD_RX_BYTES) {
+        board->bytes_lost++;
+        return;
+    }
+    uint8_t last = (peer->rx_first + peer->rx_count) % BOARD_RX_BYTES;
+    peer->rx[last] = data;
+    peer->rx_scan[last] = board->scans;
+    peer->rx_count++;
+}
+
+
+/** Take the next byte sent by the other board, dropping any that weren't polled for in time.
+    @return IR_SERIAL_OK with the byte, or IR_SERIAL_NONE if there isn't one */
+ir_serial_ret_t ir_serial_receive(uint8_t* data)
+{
+    board_t* board = board_current;
+
+    while (board->rx_count) {
+        uint8_t first = board->rx_first;
+        board->rx_first = (first + 1) % BOARD_RX_BYTES;
+        board->rx_count--;
+        if (board->scans - board->rx_scan[first] <= BOARD_AIR_SCANS) {
+            *data = board->rx[first];
+            return IR_SERIAL_OK;
+        }
+        board->peer->bytes_lost++;
+    }
+    return IR_SERIAL_NONE;
+}
@@ -0,0 +1,84 @@
+/**
+  @file board.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Simulated UCFK4 boards for the host harness. Each board runs one game as a coroutine
+         with its own driver state, and boards are paired up to play each other over a
+         simulated IR link. The drivers in board.c act on whichever board is running.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <ucontext.h>
+#include "system.h"
+#include "gamestate.h"
+#include "game_context.h"
+
+// Bytes an IR receiver holds before further bytes are lost
+#define BOARD_RX_BYTES 64
+
+/* The bot pushing the navswitch of one board */
+typedef struct {
+    uint32_t random;
+    uint16_t hold_ticks; // Ticks left before the button held down is released
+    uint16_t idle_ticks; // Ticks left before the next push
+    bool fleet_placed; // Long pushed to auto-place the fleet since entering SETUP
+    GameState_t last_state;
+} board_bot_t;
+
+typedef struct board board_t;
+
+/* One simulated board, and the game it plays */
+struct board {
+    game_context_t game;
+    GameState_t state;
+    board_t* peer;
+    ucontext_t context;
+    uint8_t* stack;
+
+    // Simulated drivers
+    uint64_t time_us;
+    uint32_t pacer_period_us;
+    uint8_t pixels[TINYGL_WIDTH];
+    uint8_t rx[BOARD_RX_BYTES];
+    uint32_t rx_scan[BOARD_RX_BYTES]; // The sender's scan count when each byte was sent
+    uint8_t rx_first;
+    uint8_t rx_count;
+    uint8_t buttons_down;
+    uint8_t buttons_pushed;
+    board_bot_t bot;
+
+    // Results
+    uint32_t scans;
+    uint32_t games;
+    uint32_t cheats;
+    uint32_t unverified;
+    uint64_t turn_start_us; // When our last turn of this game started, or 0 before the first
+    uint64_t turns_us; // Time from the start of each of our turns to the next, in all games
+    uint32_t turns;
+    uint32_t bytes_sent;
+    uint32_t bytes_lost;
+};
+
+/** Set up a board ready to start its game, with a powered off display and an empty link.
+    @param board The board
+    @param seed Seed for the bot and the link losses of this board
+    @param stack_bytes Size of the stack to run the game on */
+void board_init(board_t* board, uint32_t seed, size_t stack_bytes);
+
+/** Free the stack of a board. */
+void board_free(board_t* board);
+
+/** Pair two boards up, so each receives what the other sends. */
+void board_pair(board_t* a, board_t* b);
+
+/** Run a board on this thread until its game next waits on the pacer.
+    @param board The board */
+void board_resume(board_t* board);
+
+/** Set the chance of each byte sent over IR being lost, shared by every board.
+    @param probability The chance, from 0 to 1 */
+void board_set_loss(double probability);
+
+#endif // BOARD_H
@@ -0,0 +1,212 @@
+/**
+  @file harness.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host harness that plays many independent games of Battleships at once, to check
+         the game contexts don't share state and to measure throughput. Pairs of simulated
+         boards (see board.h) play each other, spread over a pool of threads. Each board is
+         played by a bot and every game ends with the fleets swapped and checked, so a board
+         that finds the other cheating means the two games got mixed up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include "board.h"
+
+#define DEFAULT_PAIRS 1000
+#define DEFAULT_GAMES 1
+#define DEFAULT_STUCK_SECONDS 600
+#define STACK_BYTES (32 * 1024)
+
+/* Two boards playing each other */
+typedef struct {
+    board_t boards[2];
+    uint32_t games;
+    uint64_t progress_us; // Simulated time when the pair last finished a game
+    bool done;
+    bool stuck;
+} pair_t;
+
+/* The pairs run by one thread */
+typedef struct {
+    pthread_t thread;
+    pair_t* pairs;
+    size_t count;
+} worker_t;
+
+static const char* const state_names[] = {
+    "SETUP", "ATTACK", "WAIT", "HIT", "MISS", "SUNK", "SALVO", "WIN", "LOSS"
+};
+
+static uint32_t games_per_pair = DEFAULT_GAMES;
+static uint64_t stuck_us = DEFAULT_STUCK_SECONDS * 1000000ULL;
+
+
+/** Run the pairs of a worker in step, a scan at a time, until each has played its games or
+    got stuck.
+    @param arg The worker_t
+    @return NULL */
+static void* worker_run(void* arg)
+{
+    worker_t* worker = arg;
+    size_t active = worker->count;
+
+    while (active) {
+        for (size_t i = 0; i < worker->count; i++) {
+            pair_t* pair = &worker->pairs[i];
+            if (pair->done) {
+                continue;
+            }
+            board_resume(&pair->boards[0]);
+            board_resume(&pair->boards[1]);
+
+            // Both boards count a game once the fleets have been checked
+            uint32_t games = pair->boards[0].games < pair->boards[1].games
+                             ? pair->boards[0].games : pair->boards[1].games;
+            uint64_t now = pair->boards[0].time_us;
+            if (games != pair->games) {
+                pair->games = games;
+                pair->progress_us = now;
+            }
+            if (games >= games_per_pair) {
+                pair->done = true;
+            } else if (now - pair->progress_us > stuck_us) {
+                pair->done = true;
+                pair->stuck = true;
+            }
+            active -= pair->done;
+        }
+    }
+    return NULL;
+}
+
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-p pairs] [-t threads] [-g games] [-l loss] [-s seed] "
+            "[-x stuck seconds]\n", name);
+    exit(2);
+}
+
+
+int main(int argc, char** argv)
+{
+    size_t pair_count = DEFAULT_PAIRS;
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t seed = 1;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:t:g:l:s:x:h")) != -1) {
+        switch (option) {
+            case 'p':
+                pair_count = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                thread_count = strtol(optarg, NULL, 0);
+                break;
+            case 'g':
+                games_per_pair = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                board_set_loss(strtod(optarg, NULL));
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            case 'x':
+                stuck_us = strtoull(optarg, NULL, 0) * 1000000ULL;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (pair_count == 0 || thread_count < 1) {
+        usage(argv[0]);
+    }
+    if ((size_t)thread_count > pair_count) {
+        thread_count = pair_count;
+    }
+
+    pair_t* pairs = calloc(pair_count, sizeof(*pairs));
+    worker_t* workers = calloc(thread_count, sizeof(*workers));
+    if (!pairs || !workers) {
+        return 1;
+    }
+    for (size_t i = 0; i < pair_count; i++) {
+        board_init(&pairs[i].boards[0], seed * 2654435761u + 2 * i + 1, STACK_BYTES);
+        board_init(&pairs[i].boards[1], seed * 2654435761u + 2 * i + 2, STACK_BYTES);
+        board_pair(&pairs[i].boards[0], &pairs[i].boards[1]);
+        pairs[i].progress_us = pairs[i].boards[0].time_us;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t first = 0;
+    for (long i = 0; i < thread_count; i++) {
+        size_t count = pair_count / thread_count + ((size_t)i < pair_count % thread_count);
+        workers[i].pairs = &pairs[first];
+        workers[i].count = count;
+        first += count;
+        pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+    }
+    for (long i = 0; i < thread_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    uint64_t games = 0, cheats = 0, unverified = 0, stuck = 0;
+    uint64_t scans = 0, requests = 0, retransmits = 0, blocked_ticks = 0;
+    uint64_t bytes_sent = 0, bytes_lost = 0, turns = 0, turns_us = 0;
+    for (size_t i = 0; i < pair_count; i++) {
+        games += pairs[i].games;
+        stuck += pairs[i].stuck;
+        if (pairs[i].stuck) {
+            printf("pair %zu stuck in states %s and %s\n", i, 
+                   state_names[pairs[i].boards[0].state], state_names[pairs[i].boards[1].state]);
+        }
+        for (int j = 0; j < 2; j++) {
+            board_t* board = &pairs[i].boards[j];
+            cheats += board->cheats;
+            unverified += board->unverified;
+            scans += board->scans;
+            requests += board->game.link.link_stats.requests;
+            retransmits += board->game.link.link_stats.retransmits;
+            blocked_ticks += board->game.link.link_stats.blocked_ticks;
+            bytes_sent += board->bytes_sent;
+            bytes_lost += board->bytes_lost;
+            turns += board->turns;
+            turns_us += board->turns_us;
+            board_free(board);
+        }
+    }
+
+    // Every scan of every board is a scan of the display, at DISPLAY_RATE on the board
+    double simulated = (double)scans * pairs[0].boards[0].pacer_period_us / 1e6;
+    printf("%zu pairs on %ld threads\n", pair_count, thread_count);
+    printf("games %llu, stuck pairs %llu, cheat verdicts %llu, unverified fleets %llu\n", 
+           (unsigned long long)games, (unsigned long long)stuck, (unsigned long long)cheats,
+           (unsigned long long)unverified);
+    printf("wall time %.2f s, %.1f games/s, %.0fx real time per board\n", seconds,
+           games / seconds, simulated / seconds);
+    if (games) {
+        printf("mean game %.1f s on the board, %.1f requests, %.3f retransmits per request\n",
+               simulated / 2 / games, (double)requests / games,
+               requests ? (double)retransmits / requests : 0.0);
+        printf("mean %.1f s per game blocked on the link\n", 
+               (double)blocked_ticks * SHADE_SCANS_PER_TICK * pairs[0].boards[0].pacer_period_us / 1e6 / games);
+    }
+    if (turns) {
+        printf("mean turn cycle %.1f ms\n", turns_us / 1e3 / turns);
+    }
+    printf("bytes sent %llu, lost %llu\n", (unsigned long long)bytes_sent,
+           (unsigned long long)bytes_lost);
+
+    free(pairs);
+    free(workers);
+    return (stuck || cheats || unverified || games < pair_count * games_per_pair) ? 1 : 0;
+}
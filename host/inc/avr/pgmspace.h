@@ -0,0 +1,16 @@
+/**
+  @file pgmspace.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for avr-libc's program memory access. A host has one address space.
+ */
+
+#ifndef PGMSPACE_H
+#define PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+
+#endif // PGMSPACE_H
@@ -0,0 +1,13 @@
+/**
+  @file ir.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 IR driver. The game only uses it through ir_serial.
+ */
+
+#ifndef IR_H
+#define IR_H
+
+#include "system.h"
+
+#endif // IR_H
@@ -0,0 +1,27 @@
+/**
+  @file ir_serial.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 IR serial driver. Each simulated board sends to the 
+         other board of its pair, see board.c.
+ */
+
+#ifndef IR_SERIAL_H
+#define IR_SERIAL_H
+
+#include "system.h"
+
+typedef enum ir_serial_ret {
+    IR_SERIAL_OK = 1,
+    IR_SERIAL_NONE = 0,
+    IR_SERIAL_PARITY_ERROR = -1,
+    IR_SERIAL_ERROR = -2
+} ir_serial_ret_t;
+
+void ir_serial_init(void);
+
+void ir_serial_transmit(uint8_t data);
+
+ir_serial_ret_t ir_serial_receive(uint8_t* data);
+
+#endif // IR_SERIAL_H
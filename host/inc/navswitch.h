@@ -0,0 +1,28 @@
+/**
+  @file navswitch.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 navswitch driver. The buttons of each simulated board 
+         are pushed by a bot, see board.c.
+ */
+
+#ifndef NAVSWITCH_H
+#define NAVSWITCH_H
+
+#include "system.h"
+
+enum {
+    NAVSWITCH_NORTH,
+    NAVSWITCH_EAST,
+    NAVSWITCH_SOUTH,
+    NAVSWITCH_WEST,
+    NAVSWITCH_PUSH
+};
+
+void navswitch_update(void);
+
+bool navswitch_push_event_p(uint8_t navswitch);
+
+bool navswitch_down_p(uint8_t navswitch);
+
+#endif // NAVSWITCH_H
@@ -0,0 +1,20 @@
+/**
+  @file pacer.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 pacer. Waiting for the pacer hands the thread over to
+         the next simulated board, see board.c.
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include "system.h"
+
+typedef uint16_t pacer_rate_t;
+
+void pacer_init(pacer_rate_t pacer_rate);
+
+void pacer_wait(void);
+
+#endif // PACER_H
@@ -0,0 +1,13 @@
+/**
+  @file pio.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 PIO driver. The game doesn't use any pins directly.
+ */
+
+#ifndef PIO_H
+#define PIO_H
+
+#include "system.h"
+
+#endif // PIO_H
@@ -0,0 +1,19 @@
+/**
+  @file system.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 system driver, for the harness in host/.
+ */
+
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define F_CPU 8000000
+
+void system_init(void);
+
+#endif // SYSTEM_H
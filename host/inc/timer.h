@@ -0,0 +1,19 @@
+/**
+  @file timer.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the UCFK4 timer, counting the simulated time of the running board.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "system.h"
+
+#define TIMER_RATE (F_CPU / 1024)
+
+typedef uint16_t timer_tick_t;
+
+timer_tick_t timer_get(void);
+
+#endif // TIMER_H
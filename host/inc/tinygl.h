@@ -0,0 +1,32 @@
+/**
+  @file tinygl.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Host stand-in for the part of tinygl the game uses. Pixels go into a frame buffer 
+         kept per simulated board.
+ */
+
+#ifndef TINYGL_H
+#define TINYGL_H
+
+#include "system.h"
+
+#define TINYGL_WIDTH 5
+#define TINYGL_HEIGHT 7
+
+typedef int8_t tinygl_coord_t;
+
+typedef struct tinygl_point {
+    tinygl_coord_t x;
+    tinygl_coord_t y;
+} tinygl_point_t;
+
+typedef uint8_t tinygl_pixel_value_t;
+
+void tinygl_init(uint16_t update_rate);
+
+void tinygl_pixel_set(tinygl_point_t point, tinygl_pixel_value_t pixel_value);
+
+void tinygl_update(void);
+
+#endif // TINYGL_H
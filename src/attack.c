@@ -11,54 +11,100 @@
 #include "gamestate.h"
 #include "pio.h"
 #include "communication.h"
+#include "shade.h"
+#include "input.h"
+#include "verify.h"
+#include "message.h"
+#include "wheel.h"
+#include "game_context.h"
 
-#define MAX_HITS 8 
 #define FLASH_RATE 200
+#define HIT_SHADE SHADE_MEDIUM
+#define MISS_SHADE SHADE_DIM
+#define CURSOR_SHADE SHADE_FULL
+#define TARGET_SHADE SHADE_FULL
+#define SUMMARY_DURATION 500
+#define SUMMARY_HIT_SHADE SHADE_FULL
+#define SUMMARY_MISS_SHADE SHADE_DIM
 
-static tinygl_point_t hit_positions[10];
-static uint8_t number_of_hits;
-static uint8_t number_of_opponent_hits = 0;
-static tinygl_point_t cursor_position;
-
-void reset_hits(void) {
-    cursor_position.x = 0;
-    cursor_position.y = 0;
-    number_of_opponent_hits = 0;
-    number_of_hits = 0;
+void reset_hits(CTX_PARAM) {
+    ctx->attack.cursor_position.x = 0;
+    ctx->attack.cursor_position.y = 0;
+    ctx->attack.number_of_opponent_hits = 0;
+    ctx->attack.number_of_hits = 0;
+    ctx->attack.sunk_ship = NO_SHIP;
+    ctx->attack.ships_sunk = 0;
+    ctx->attack.number_of_targets = 0;
     for (uint8_t i = 0; i < MAX_HITS; i++) {
-        hit_positions[i].x = 0;
-        hit_positions[i].y = 0;
+        ctx->attack.hit_positions[i].x = 0;
+        ctx->attack.hit_positions[i].y = 0;
+    }
+    for (uint8_t col = 0; col < NUM_COLS; col++) {
+        ctx->attack.fired_cells[col] = 0;
     }
 }
 
-void increment_oponent_hits(void) {
-    number_of_opponent_hits++;
+void increment_oponent_hits(CTX_PARAM) {
+    ctx->attack.number_of_opponent_hits++;
 }
-/** Update each pixel on the display that the player
-    has already hit, from the hit_positions array
-*/
-static void update_hit_pixels(void)
+
+/** Get the ship sunk by the most recent attack
+    @return Index of the ship, or NO_SHIP */
+uint8_t get_sunk_ship(CTX_PARAM) {
+    return ctx->attack.sunk_ship;
+}
+
+/** Check whether a cell has already been fired at.
+    @param cell The cell
+    @return Whether it has been fired at */
+static bool cell_fired_p(CTX_PARAMS tinygl_point_t cell)
 {
+    return (ctx->attack.fired_cells[cell.x] >> cell.y) & 1;
+}
 
-    for (uint8_t i = 0; i < number_of_hits; i++) {
-        if (!(cursor_position.x == hit_positions[i].x && cursor_position.y == hit_positions[i].y)) {
-            tinygl_draw_point(hit_positions[i], 1);
-        }
-    }
+/** Record that a cell has been fired at, whatever the outcome.
+    @param cell The cell */
+static void record_fired(CTX_PARAMS tinygl_point_t cell)
+{
+    ctx->attack.fired_cells[cell.x] |= 1 << cell.y;
 }
 
-/** Check if a current cursor position has already been hit.
-    @returns Returns 1 if hit, 0 if not
+/** Update each pixel on the display that the player has already
+    fired at. Misses are drawn dimmer than the hits from the 
+    hit_positions array.
 */
-static bool position_already_hit(void)
+static void update_hit_pixels(CTX_PARAM)
 {
-
-    for (uint8_t i = 0; i < number_of_hits; i++) {
-        if (cursor_position.x == hit_positions[i].x && cursor_position.y == hit_positions[i].y) {
-            return 1;
+    for (uint8_t col = 0; col < NUM_COLS; col++) {
+        for (uint8_t row = 0; row < NUM_OF_ROWS; row++) {
+            tinygl_point_t cell = {col, row};
+            if (cell_fired_p(CTX_ARGS cell) && !(ctx->attack.cursor_position.x == col 
+                                                 && ctx->attack.cursor_position.y == row)) {
+                shade_draw_point(CTX_ARGS cell, MISS_SHADE); // Hits are drawn over below
+            }
+        }
+    }
+    for (uint8_t i = 0; i < ctx->attack.number_of_hits; i++) {
+        if (!(ctx->attack.cursor_position.x == ctx->attack.hit_positions[i].x 
+              && ctx->attack.cursor_position.y == ctx->attack.hit_positions[i].y)) {
+            shade_draw_point(CTX_ARGS ctx->attack.hit_positions[i], HIT_SHADE);
+        }
+    }
+    for (uint8_t i = 0; i < ctx->attack.number_of_targets; i++) {
+        if (!(ctx->attack.cursor_position.x == ctx->attack.salvo_targets[i].x 
+              && ctx->attack.cursor_position.y == ctx->attack.salvo_targets[i].y)) {
+            shade_draw_point(CTX_ARGS ctx->attack.salvo_targets[i], TARGET_SHADE);
         }
     }
-    return 0;
+}
+
+/** Check if a current cursor position has already been fired at,
+    so firing there again would waste the turn.
+    @returns Returns 1 if fired at, 0 if not
+*/
+static bool position_already_fired(CTX_PARAM)
+{
+    return cell_fired_p(CTX_ARGS ctx->attack.cursor_position);
 }
 
 /** Check the firing position is valid, send 
@@ -66,16 +112,23 @@ static bool position_already_hit(void)
     @return returns the next game state 
     (hit, miss or win)
  */
-static GameState_t send_attack(void)
+static GameState_t send_attack(CTX_PARAM)
 {
 
-    if (!(position_already_hit())) {
-        if (hit_request(&cursor_position)) { 
-            hit_positions[number_of_hits] = cursor_position;
-            number_of_hits += 1;
-            if (number_of_hits == MAX_HITS) {
+    if (!(position_already_fired(CTX_ARG))) {
+        bool hit = hit_request(CTX_ARGS &ctx->attack.cursor_position, &ctx->attack.sunk_ship);
+        verify_record_shot(CTX_ARGS ctx->attack.cursor_position, hit, ctx->attack.sunk_ship);
+        record_fired(CTX_ARGS ctx->attack.cursor_position);
+        if (hit) { 
+            ctx->attack.hit_positions[ctx->attack.number_of_hits] = ctx->attack.cursor_position;
+            ctx->attack.number_of_hits += 1;
+            if (ctx->attack.number_of_hits == MAX_HITS) {
                 return WIN; // We've hit all the ships. Change the game state.
             }
+            if (ctx->attack.sunk_ship != NO_SHIP) {
+                ctx->attack.ships_sunk++;
+                return SUNK; // Turn is over, and that hit sank a ship.
+            }
             return HIT;// Turn is over, and we hit. Change the game state
         }
         return MISS;// Turn is over, and we missed. Change the game state
@@ -84,72 +137,185 @@ static GameState_t send_attack(void)
     return ATTACK; // Turn is not over, keep the existing state
 }
 
-/** Uses a division of the paced loop to flash the boat 
+/** Fire every marked target at the second board in one exchange
+    @return returns the next game state 
+    (salvo summary or win)
+ */
+static GameState_t send_salvo(CTX_PARAM)
+{
+    uint8_t sunk = 0;
+    ctx->attack.salvo_hits = salvo_request(CTX_ARGS ctx->attack.salvo_targets, 
+                                           ctx->attack.number_of_targets, &sunk);
+    ctx->attack.ships_sunk += sunk;
+    verify_record_sinks(CTX_ARGS sunk);
+
+    for (uint8_t i = 0; i < ctx->attack.number_of_targets; i++) {
+        bool hit = (ctx->attack.salvo_hits >> i) & 1;
+        verify_record_shot(CTX_ARGS ctx->attack.salvo_targets[i], hit, NO_SHIP);
+        record_fired(CTX_ARGS ctx->attack.salvo_targets[i]);
+        if (hit) {
+            ctx->attack.hit_positions[ctx->attack.number_of_hits] = ctx->attack.salvo_targets[i];
+            ctx->attack.number_of_hits += 1;
+        }
+    }
+
+    if (ctx->attack.number_of_hits == MAX_HITS) {
+        return WIN; // We've hit all the ships. Change the game state.
+    }
+    return SALVO; // Turn is over, show what the salvo did
+}
+
+/** Mark the cursor position as a salvo target, or unmark it if
+    it's already marked. Fires once there is one target for each 
+    ship still afloat.
+    @return returns the next game state 
+ */
+static GameState_t mark_target(CTX_PARAM)
+{
+    for (uint8_t i = 0; i < ctx->attack.number_of_targets; i++) {
+        if (ctx->attack.cursor_position.x == ctx->attack.salvo_targets[i].x 
+            && ctx->attack.cursor_position.y == ctx->attack.salvo_targets[i].y) {
+            // Unmark, moving the last target into the gap
+            ctx->attack.number_of_targets--;
+            ctx->attack.salvo_targets[i] = ctx->attack.salvo_targets[ctx->attack.number_of_targets];
+            shade_clear(CTX_ARG);
+            return ATTACK;
+        }
+    }
+
+    if (!(position_already_fired(CTX_ARG))) {
+        ctx->attack.salvo_targets[ctx->attack.number_of_targets] = ctx->attack.cursor_position;
+        ctx->attack.number_of_targets += 1;
+    }
+
+    if (ctx->attack.number_of_targets == NUM_SHIPS - ctx->attack.ships_sunk) {
+        return send_salvo(CTX_ARG);
+    }
+    return ATTACK; // Turn is not over, keep the existing state
+}
+
+/** Show the outcome of the last salvo in a single frame, the 
+    targets that hit brightly and the misses dimly.
+    @return The next game state */
+GameState_t salvo_summary(CTX_PARAM)
+{
+    if (!ctx->attack.summary_shown) {
+        ctx->attack.summary_shown = true;
+        wheel_timer_start(CTX_ARGS WHEEL_TIMER_SALVO_SUMMARY, SUMMARY_DURATION, 0, NULL);
+        shade_clear(CTX_ARG);
+        for (uint8_t i = 0; i < ctx->attack.number_of_targets; i++) {
+            bool hit = (ctx->attack.salvo_hits >> i) & 1;
+            shade_draw_point(CTX_ARGS ctx->attack.salvo_targets[i], 
+                             hit ? SUMMARY_HIT_SHADE : SUMMARY_MISS_SHADE);
+        }
+    }
+
+    bool finished = !wheel_timer_running_p(CTX_ARGS WHEEL_TIMER_SALVO_SUMMARY);
+    GameState_t next_state = outcome_update(CTX_ARGS finished, SALVO);
+    if (next_state == SALVO) {
+        return SALVO;
+    }
+
+    // Stop the timer in case the summary was skipped part way through
+    wheel_timer_stop(CTX_ARGS WHEEL_TIMER_SALVO_SUMMARY);
+    ctx->attack.summary_shown = false;
+    ctx->attack.number_of_targets = 0;
+    shade_clear(CTX_ARG);
+    return next_state;
+}
+
+/** Toggle the cursor, each time the cursor flash timer expires.
+    @param timer The expired timer */
+static void toggle_cursor(CTX_PARAMS uint8_t timer)
+{
+    (void)timer;
+    shade_clear(CTX_ARG);
+    ctx->attack.flash_state = !ctx->attack.flash_state;
+}
+
+/** Flash the cursor with a periodic timer, started on the first call
     @return on/off led flash
  */
-static bool flash_cursor(void) 
+static bool flash_cursor(CTX_PARAM) 
 {
-    // Keep track of elapsed time in order to flash the cursor
-    static uint16_t flash = 0;
-    static bool state = 1;
-    flash++;
+    if (!wheel_timer_running_p(CTX_ARGS WHEEL_TIMER_CURSOR_FLASH)) {
+        wheel_timer_start(CTX_ARGS WHEEL_TIMER_CURSOR_FLASH, FLASH_RATE, FLASH_RATE, 
+                          toggle_cursor);
+    }
+    return ctx->attack.flash_state;
+}
 
-    if (flash >= FLASH_RATE) {
-        tinygl_clear();
-        state = !state;
-        flash = 0;
+/** Move the cursor one cell in a direction, jumping over cells
+    already fired at. If every cell that way has been fired at, the
+    cursor moves one cell anyway, so a cell left elsewhere on a 
+    nearly full board can still be reached.
+    @param dx Step in x, -1, 0 or 1
+    @param dy Step in y, -1, 0 or 1
+ */
+static void move_cursor(CTX_PARAMS int8_t dx, int8_t dy)
+{
+    tinygl_point_t next = {ctx->attack.cursor_position.x + dx, 
+                           ctx->attack.cursor_position.y + dy};
+    if (next.x < 0 || next.x >= NUM_COLS || next.y < 0 || next.y >= NUM_OF_ROWS) {
+        return;
     }
-    return state;
+
+    tinygl_point_t cell = next;
+    while (cell_fired_p(CTX_ARGS cell)) {
+        cell.x += dx;
+        cell.y += dy;
+        if (cell.x < 0 || cell.x >= NUM_COLS || cell.y < 0 || cell.y >= NUM_OF_ROWS) {
+            cell = next;
+            break;
+        }
+    }
+
+    shade_clear(CTX_ARG);
+    ctx->attack.cursor_position = cell;
 }
 
 /** Update the attack position using the navswitch, 
     and send an attack if the middle button is pressed.
  */
-static GameState_t select_attack_position(void)
+static GameState_t select_attack_position(CTX_PARAM)
 {
 
-    if (navswitch_push_event_p (NAVSWITCH_SOUTH)) {
-        if (cursor_position.y < 6) {
-            tinygl_clear();
-            cursor_position.y += 1; 
-        }
+    if (input_event_p(CTX_ARGS NAVSWITCH_SOUTH)) {
+        move_cursor(CTX_ARGS 0, 1);
     }
-    if (navswitch_push_event_p (NAVSWITCH_EAST)) {
-        if (cursor_position.x < 4) {
-            tinygl_clear();
-            cursor_position.x += 1; 
-        }
+    if (input_event_p(CTX_ARGS NAVSWITCH_EAST)) {
+        move_cursor(CTX_ARGS 1, 0);
     }
-    if (navswitch_push_event_p (NAVSWITCH_NORTH)) {
-        if (cursor_position.y > 0) {
-            tinygl_clear();
-            cursor_position.y -= 1;
-        }
+    if (input_event_p(CTX_ARGS NAVSWITCH_NORTH)) {
+        move_cursor(CTX_ARGS 0, -1);
     }
-    if (navswitch_push_event_p (NAVSWITCH_WEST)) {
-        
-        if (cursor_position.x > 0) {
-            tinygl_clear();
-            cursor_position.x -= 1; 
-        }
+    if (input_event_p(CTX_ARGS NAVSWITCH_WEST)) {
+        move_cursor(CTX_ARGS -1, 0);
     }
 
-    tinygl_draw_point(cursor_position, flash_cursor());
+    shade_draw_point(CTX_ARGS ctx->attack.cursor_position, 
+                     flash_cursor(CTX_ARG) ? CURSOR_SHADE : SHADE_OFF);
 
-    if (navswitch_push_event_p (NAVSWITCH_PUSH)) {
-        return send_attack();
+    if (input_event_p(CTX_ARGS NAVSWITCH_PUSH)) {
+        return SALVO_MODE ? mark_target(CTX_ARG) : send_attack(CTX_ARG);
     }
 
     return ATTACK; // select_attack_position
 } 
 
 /** main function to run attack state */
-GameState_t attack(void)
+GameState_t attack(CTX_PARAM)
 {
-    GameState_t game_state = select_attack_position();
-    if (number_of_opponent_hits >= MAX_HITS) {
-        return LOSS;
+    GameState_t game_state = select_attack_position(CTX_ARG);
+    if (ctx->attack.number_of_opponent_hits >= MAX_HITS) {
+        game_state = LOSS;
+    } else {
+        update_hit_pixels(CTX_ARG);
+    }
+
+    if (game_state != ATTACK) {
+        // The flash timer clears the display, so it must only run while aiming
+        wheel_timer_stop(CTX_ARGS WHEEL_TIMER_CURSOR_FLASH);
     }
-    update_hit_pixels();
     return game_state;
 }
\ No newline at end of file
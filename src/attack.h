@@ -12,24 +12,42 @@
 #include "navswitch.h"
 #include "tinygl.h"
 #include "gamestate.h"
+#include "communication.h"
+#include "context.h"
+
+#define MAX_HITS 8
+
+/* State of the attack phase, part of game_context_t */
+typedef struct {
+    tinygl_point_t hit_positions[10];
+    uint8_t number_of_hits;
+    uint8_t fired_cells[NUM_COLS]; // One bit per row of each column, set once fired at
+    uint8_t number_of_opponent_hits;
+    uint8_t sunk_ship;
+    tinygl_point_t cursor_position;
+    uint8_t ships_sunk;
+    tinygl_point_t salvo_targets[SALVO_MAX]; // Targets marked for the next salvo
+    uint8_t number_of_targets;
+    uint8_t salvo_hits; // Which of the last salvo hit
+    bool summary_shown;
+    bool flash_state;
+} attack_context_t;
+
+#define ATTACK_CONTEXT_INIT {.sunk_ship = NO_SHIP, .flash_state = 1}
 
 // Public
-GameState_t attack(void);
+GameState_t attack(CTX_PARAM);
 
+/** Get the ship sunk by the most recent attack
+    @return Index of the ship, or NO_SHIP */
+uint8_t get_sunk_ship(CTX_PARAM);
 
-// Private
+/** Show the outcome of the last salvo in a single frame, the 
+    targets that hit brightly and the misses dimly.
+    @return The next game state */
+GameState_t salvo_summary(CTX_PARAM);
 
-tinygl_point_t hit_positions[10];
-uint8_t number_of_hits;
-tinygl_point_t cursor_position;
-
-GameState_t select_attack_position(void);
-bool flash_cursor(void);
-GameState_t send_attack(void);
-bool position_already_hit(void);
-void update_hit_pixels(void);
-void increment_oponent_hits(void);
-void boat_length(void);
+void increment_oponent_hits(CTX_PARAM);
 
 
 #endif // ATTACK_H
\ No newline at end of file
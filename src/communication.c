@@ -7,11 +7,15 @@
 
 #include "system.h"
 #include "ir_serial.h"
+#include "timer.h"
 #include "tinygl.h"
 #include "communication.h"
 #include "gamestate.h"
 #include "attack.h"
-#include "pacer.h"
+#include "shade.h"
+#include "verify.h"
+#include "trace.h"
+#include "game_context.h"
 
 /* We'll define a packet format. 
 
@@ -23,131 +27,665 @@ X and Y: data
     - x and y position for a hit request,
     - both 0x111 for a sucessful hit response
     - both 0x000 for a unsuccessful hit response
+    - 0x000 and the sunk ship index for a hit that sinks a ship
     - unused for a game initialiser
 */
 
-// Store a local copy of this players boats, to allow checking for hits later
-tinygl_point_t own_boats[8] = {{0,0}};
+#define FLEET_CELL_EMPTY 0xFF
+#define FLEET_CELL_HIT 0x80
 
+// Roughly how long ir_serial takes to send one byte, and one tick of the paced loop. 
+#define LINK_BYTE_US 18000
+#define LINK_TICK_US 2000
+
+// The longest an answer can take, from the end of our packet. The other board may be partway
+// through sending a packet of its own, and then takes up to a tick to notice ours before it 
+// sends the answer. 
+#define LINK_ROUND_TRIP_US (2 * LINK_BYTE_US + LINK_TICK_US)
+#define LINK_ROUND_TRIP_TIMER_TICKS ((uint16_t)((uint32_t)TIMER_RATE * LINK_ROUND_TRIP_US / 1000000))
+
+// How many round trips an answer may take before the packet is sent again. This is longer
+// than the worst case, so an answer that is merely slow isn't counted as lost.
+#define LINK_TIMEOUT_TRIPS 3
+
+// Ticks left between packets sent without waiting on an answer, so the other board is back 
+// to polling after receiving one before the next starts
+#define LINK_GAP_TICKS 2
 
 /** Returns whether a position is a hit against this players boat
  *  @param position The position of the boat
  *  @return Whether that position contains a boat */
-bool remote_is_hit(tinygl_point_t position) {
-    for (uint8_t i = 0; i < 8; i++) {
-        if (position.x == own_boats[i].y && position.y == own_boats[i].x) {
-            return true;
+bool remote_is_hit(CTX_PARAMS tinygl_point_t position) {
+    return ctx->link.fleet_map[position.y][position.x] != FLEET_CELL_EMPTY;
+}
+
+
+/** Stores this players boats locally, for transferring from setup.c to communication.c
+ *  @param starts Array of the first cell of each boat
+ *  @param ends Array of the last cell of each boat
+ *  @param count Number of boats in the arrays */
+void store_own_boats(CTX_PARAMS tinygl_point_t* starts, tinygl_point_t* ends, uint8_t count) {
+    for (uint8_t row = 0; row < NUM_OF_ROWS; row++) {
+        for (uint8_t col = 0; col < NUM_COLS; col++) {
+            ctx->link.fleet_map[row][col] = FLEET_CELL_EMPTY;
         }
     }
-    return false;
+
+    // Boats are placed vertically, so each covers one column from start to end
+    for (uint8_t i = 0; i < count; i++) {
+        ctx->link.ship_length[i] = 0;
+        ctx->link.ship_hits[i] = 0;
+        for (uint8_t row = starts[i].y; row <= ends[i].y; row++) {
+            ctx->link.fleet_map[row][starts[i].x] = i;
+            ctx->link.ship_length[i]++;
+        }
+        shade_draw_line(CTX_ARGS starts[i], ends[i], SHADE_DIM);
+    }
 }
 
 
-/** Stores a list of boat positions locally, for transferring from setup.c 
-*  to communication.c
- *  @param positions Array of position vectors */
-void store_own_boats(tinygl_point_t* positions) {
-    for (uint8_t i = 0; i < 8; i++) {  
-        own_boats[i].x = positions[i].x;
-        own_boats[i].y = positions[i].y;
-        tinygl_draw_point(positions[i], 1);
+/** Send a packet to the other board, logging it in the trace.
+*  @param packet The packet to send */
+static void link_transmit(CTX_PARAMS uint8_t packet)
+{
+    (void)ctx; // Only the trace uses it
+    TRACE_EVENT(TRACE_SENT, packet);
+    ir_serial_transmit(packet);
+}
+
+
+
+
+/** Poll for a packet from the other board, logging anything received in the trace.
+*  @param data A pointer to a uint8_t to store the packet
+*  @return The result from ir_serial_receive */
+static ir_serial_ret_t link_receive(CTX_PARAMS uint8_t* data)
+{
+    (void)ctx; // Only the trace uses it
+    ir_serial_ret_t ret = ir_serial_receive(data);
+    if (ret == IR_SERIAL_OK) {
+        TRACE_EVENT(TRACE_RECEIVED, *data);
+    } else if (ret < 0) {
+        TRACE_EVENT(TRACE_RECEIVE_ERROR, -ret);
     }
+    return ret;
 }
 
 
 /** Sends a hit request packet over IR to the other board.
 *  @param position Position to probe
+*  @param sunk_ship Set to the index of the ship sunk by this hit, or NO_SHIP
 *  @return Whether the response was a hit */
-bool hit_request(tinygl_point_t* cursor_position)
+bool hit_request(CTX_PARAMS tinygl_point_t* cursor_position, uint8_t* sunk_ship)
 {
     // Form the packet
     uint8_t packet = REQUEST_HEADER; // zero for request
 
     // Encode the x and y positions into the packet
-    packet += (cursor_position->y << Y_SHIFT);
-    packet += (cursor_position->x);
+    packet += (cursor_position->x << X_SHIFT);
+    packet += (cursor_position->y);
   
     // Send the request
     uint8_t response;
-    send_and_wait(packet, &response);
+    send_and_wait(CTX_ARGS packet, &response);
 
     // Process the response
+    *sunk_ship = NO_SHIP;
+    if ((response & ~SHIP_BITMASK) == RESPONSE_SUNK) {
+        *sunk_ship = response & SHIP_BITMASK;
+        return true;
+    }
     return (response == RESPONSE_HIT); // Evaluates true for hit, false for miss.
 }
 
 
-/** Sends a packet and wait for a response.
-*  @param packet The data packet to send
+/** Answer a hit request packet, if it is a valid one, noting the other board's turn unless
+*  it is a resend of the last request answered.
+*  @param data The received packet
+*  @return Whether the packet was a valid hit request */
+static bool respond_to_request(CTX_PARAMS uint8_t data)
+{
+    tinygl_point_t cursor_position = {(data & X_BITMASK) >> X_SHIFT, data & Y_BITMASK};
+    if (cursor_position.x >= NUM_COLS || cursor_position.y >= NUM_OF_ROWS) {
+        return false;
+    }
+    if (data != ctx->link.last_request) {
+        ctx->link.last_request = data;
+        ctx->link.turn_received = true;
+    }
+    hit_response(CTX_ARGS &cursor_position);
+    return true;
+}
+
+
+/** Store a salvo target until SALVO_FIRE arrives, keeping the targets in increasing order. A
+ *  target already stored is part of a batch sent again, so it is only stored once.
+*  @param data The received packet, in the request format
+*  @return Whether the packet was a valid target */
+static bool receive_target(CTX_PARAMS uint8_t data)
+{
+    if (((data & X_BITMASK) >> X_SHIFT) >= NUM_COLS || (data & Y_BITMASK) >= NUM_OF_ROWS) {
+        return false;
+    }
+
+    uint8_t i = ctx->link.salvo_count;
+    for (uint8_t j = 0; j < i && j < SALVO_MAX; j++) {
+        if (ctx->link.salvo_targets[j] == data) {
+            return true;
+        }
+    }
+    if (i >= SALVO_MAX) {
+        // More targets than any salvo, so SALVO_FIRE is refused and the batch sent again
+        ctx->link.salvo_count = SALVO_MAX + 1;
+        return true;
+    }
+    while (i > 0 && ctx->link.salvo_targets[i - 1] > data) {
+        ctx->link.salvo_targets[i] = ctx->link.salvo_targets[i - 1];
+        i--;
+    }
+    ctx->link.salvo_targets[i] = data;
+    ctx->link.salvo_count++;
+    return true;
+}
+
+
+/** Check whether a packet is a SALVO_FIRE.
+*  @param data The packet
+*  @return Whether it fires a salvo of a size that can be fired */
+static bool salvo_fire_p(uint8_t data)
+{
+    return (data & ~SALVO_FIRE_BITMASK) == SALVO_FIRE 
+           && (data & SALVO_FIRE_COUNT_BITMASK) < SALVO_MAX;
+}
+
+
+/** Wait for the next tick of the paced loop while blocked on the other board, and poll for
+ *  a packet.
+*  @param data A pointer to a uint8_t to store the packet
+*  @return The result from link_receive */
+static ir_serial_ret_t link_poll(CTX_PARAMS uint8_t* data)
+{
+    shade_tick(CTX_ARG);
+    return link_receive(CTX_ARGS data);
+}
+
+
+/** Store a received data packet in the stream buffer and acknowledge it. The sequence bit
+ *  alternates, so a packet resent after a lost acknowledgement is only stored once.
+*  @param data The received packet */
+static void receive_nibble(CTX_PARAMS uint8_t data)
+{
+    uint8_t seq = (data & DATA_SEQ_BIT) ? 1 : 0;
+
+    if (seq == (ctx->link.stream_nibbles & 1) && ctx->link.stream_nibbles < 2 * STREAM_MAX_BYTES) {
+        uint8_t* byte = &ctx->link.stream_buffer[ctx->link.stream_nibbles >> 1];
+        if (ctx->link.stream_nibbles & 1) {
+            *byte |= (data & DATA_BITMASK) << DATA_NIBBLE_SHIFT;
+        } else {
+            *byte = data & DATA_BITMASK;
+        }
+        ctx->link.stream_nibbles++;
+    }
+    link_transmit(CTX_ARGS DATA_ACK | seq);
+}
+
+
+/** Accept INIT_READY from the other board, storing the commitment it sent before it. If the
+ *  commitment didn't all arrive, refuse it so the other board sends the commitment again.
+*  @param waiting Whether we have finished send_init, so the first INIT_READY gives us the turn
+*  @return Whether this is the first INIT_READY since send_init, rather than a resend */
+static bool answer_ready(CTX_PARAMS bool waiting)
+{
+    if (ctx->link.stream_nibbles == 2 * COMMIT_BYTES) {
+        verify_store_commitment(CTX_ARGS ctx->link.stream_buffer);
+    } else if (!verify_commitment_received_p(CTX_ARG)) {
+        ctx->link.stream_nibbles = 0;
+        link_transmit(CTX_ARGS INIT_READY_RESEND);
+        return false;
+    }
+    bool first = !ctx->link.peer_ready;
+    ctx->link.stream_nibbles = 0;
+    ctx->link.peer_ready = true;
+    if (first && waiting) {
+        // Tell the other board, and again if it resends, so it doesn't decide on commitments
+        ctx->link.ready_answer = INIT_READY_WAITING;
+    }
+    link_transmit(CTX_ARGS ctx->link.ready_answer);
+    return first;
+}
+
+
+/** React to a packet received while not waiting on an answer of our own.
+*  @param data The received packet */
+static void handle_packet(CTX_PARAMS uint8_t data)
+{
+    // Check this is an incoming packet before processing further, in an attempt to avoid crosstalk
+    if ((data >> HEADER_SHIFT) == REQUEST_HEADER) {
+        // In the salvo variant, it's a target of the next salvo rather than a shot
+        bool valid = SALVO_MODE ? receive_target(CTX_ARGS data) : respond_to_request(CTX_ARGS data);
+        if (!valid) {
+            ctx->link.link_stats.out_of_place_bytes++;
+        }
+    } else if (data == INIT_READY) {
+        // The other player has finished setup, having already sent its commitment. 
+        // If we're already waiting, it's our turn, unless this is a resend.
+        if (answer_ready(CTX_ARGS true)) {
+            ctx->link.turn_received = true;
+        }
+    } else if (salvo_fire_p(data)) {
+        salvo_response(CTX_ARGS data);
+    } else if ((data & ~(DATA_SEQ_BIT | DATA_BITMASK)) == DATA_HEADER) {
+        receive_nibble(CTX_ARGS data);
+    } else if ((data & ~EXPORT_BITMASK) != EXPORT_HEADER) {
+        // A response we aren't waiting for, probably crosstalk or a late retransmission
+        ctx->link.link_stats.out_of_place_bytes++;
+    }
+}
+
+
+/** Check whether a packet is a valid answer to one we sent.
+*  @param packet The packet we sent
+*  @param answer The packet received
+*  @return Whether it answers the packet we sent */
+static bool answers_p(uint8_t packet, uint8_t answer)
+{
+    if ((packet >> HEADER_SHIFT) == REQUEST_HEADER) {
+        return answer == RESPONSE_HIT || answer == RESPONSE_MISS
+               || ((answer & ~SHIP_BITMASK) == RESPONSE_SUNK && (answer & SHIP_BITMASK) < NUM_SHIPS);
+    }
+    if ((packet & ~(DATA_SEQ_BIT | DATA_BITMASK)) == DATA_HEADER) {
+        return answer == (DATA_ACK | ((packet & DATA_SEQ_BIT) ? 1 : 0));
+    }
+    if (packet == INIT_READY) {
+        return answer == INIT_READY_ACK || answer == INIT_READY_WAITING 
+               || answer == INIT_READY_RESEND;
+    }
+    if (salvo_fire_p(packet)) {
+        return (answer & ~SALVO_BITMASK) == SALVO_RESULT || answer == SALVO_RESEND;
+    }
+    return false;
+}
+
+
+/** Sends a batch of packets and wait for a response to the last, resending the whole batch 
+ *  until an answer of the kind it expects arrives (see answers_p). Only the last packet is
+ *  answered, so it must tell the other board whether the rest all arrived.
+*  @param packets The packets to send
+*  @param count Number of packets to send
 *  @param data A pointer to a uint8_t to store the response
 *  @note This is a blocking function, the display will freeze until we receive a response */
-void send_and_wait(uint8_t packet, uint8_t* data)
+static void send_batch_and_wait(CTX_PARAMS const uint8_t* packets, uint8_t count, uint8_t* data)
 {
+    uint8_t packet = packets[count - 1];
     // Blocking function. Send a packet and wait for a response.
     ir_serial_ret_t ret = IR_SERIAL_NONE;
     bool packet_valid = false;
+    uint16_t transmissions = 0;
+    uint16_t ticks = 0;
 
     while (!packet_valid) {//|| !incoming_packet) {
+        // Send data, leaving the other board time to take in each packet before the next.
+        // Nothing sent so far is answered before the last, but the other board may be sending
+        // packets of its own.
+        for (uint8_t i = 0; i < count; i++) {
+            for (uint8_t gap = 0; i > 0 && gap < LINK_GAP_TICKS; gap++) {
+                ret = link_poll(CTX_ARGS data);
+                if (ret == IR_SERIAL_OK) {
+                    handle_packet(CTX_ARGS *data);
+                } else if (ret < 0) {
+                    ctx->link.link_stats.invalid_bytes++;
+                }
+                ticks++;
+            }
+            link_transmit(CTX_ARGS packets[i]);
+        }
+        transmissions++;
         ret = IR_SERIAL_NONE;
-        // Send data
-        ir_serial_transmit(packet);
 
-        // Block until response received
+        // Block until response received, or until it's overdue and the packet or its answer
+        // must have been lost. The wait is timed on the clock, as a tick that receives a 
+        // byte blocks for all of it.
+        timer_tick_t sent = timer_get();
         while (ret != IR_SERIAL_OK) {
-            pacer_wait();
-            ret = ir_serial_receive(data);
+            ret = link_poll(CTX_ARGS data);
+            ticks++;
+            if (ret < 0) {
+                ctx->link.link_stats.invalid_bytes++;
+            }
+            // A salvo target isn't answered, so keep waiting rather than sending ours again
+            if (ret == IR_SERIAL_OK && SALVO_MODE && (*data >> HEADER_SHIFT) == REQUEST_HEADER) {
+                receive_target(CTX_ARGS *data);
+                ret = IR_SERIAL_NONE;
+            }
+            if ((timer_tick_t)(timer_get() - sent) >= LINK_TIMEOUT_TRIPS * LINK_ROUND_TRIP_TIMER_TICKS) {
+                break;
+            }
+        }
+        if (ret != IR_SERIAL_OK) {
+            continue;
+        }
+
+        // The other board may have missed our answer to its last request and resent it.
+        // Answer again, so it isn't left waiting on us while we wait on it. It may also have
+        // fired its next shot already, which respond_to_request notes for check_for_request.
+        if ((*data >> HEADER_SHIFT) == REQUEST_HEADER) {
+            respond_to_request(CTX_ARGS *data);
+            continue;
+        }
+        // Both boards may have finished setup together, and be streaming commitments or 
+        // declaring themselves ready to each other. Answer, rather than each board waiting
+        // on the other.
+        if ((*data & ~(DATA_SEQ_BIT | DATA_BITMASK)) == DATA_HEADER) {
+            receive_nibble(CTX_ARGS *data);
+            continue;
+        }
+        if (*data == INIT_READY) {
+            answer_ready(CTX_ARGS false);
+            continue;
+        }
+        // The other board missed our answer to its salvo, and we have moved on to our turn
+        if (salvo_fire_p(*data)) {
+            salvo_response(CTX_ARGS *data);
+            continue;
         }
     
-        // "Parity check", i.e. making sure the response is one of three valid responses
-        packet_valid = (*data == RESPONSE_HIT || *data == RESPONSE_MISS || *data == INIT_READY_ACK);
+        // "Parity check", i.e. making sure the response is an answer to this packet, rather 
+        // than a late answer to an earlier one
+        packet_valid = answers_p(packet, *data);
+        if (!packet_valid) {
+            ctx->link.link_stats.invalid_bytes++;
+        }
+    }
+
+    // Record how long the request took, and how many attempts
+    ctx->link.link_stats.requests++;
+    ctx->link.link_stats.rtt_last = ticks;
+    if (ticks > ctx->link.link_stats.rtt_max) {
+        ctx->link.link_stats.rtt_max = ticks;
+    }
+    ctx->link.link_stats.rtt_total += ticks;
+    ctx->link.link_stats.blocked_ticks += ticks;
+    ctx->link.link_stats.retransmits += transmissions - 1;
+    if (transmissions - 1 > ctx->link.link_stats.retransmits_max) {
+        ctx->link.link_stats.retransmits_max = transmissions - 1;
     }
 }
 
 
+/** Sends a packet and wait for a response, resending it until an answer of the kind it
+ *  expects arrives (see answers_p).
+*  @param packet The data packet to send
+*  @param data A pointer to a uint8_t to store the response
+*  @note This is a blocking function, the display will freeze until we receive a response */
+void send_and_wait(CTX_PARAMS uint8_t packet, uint8_t* data)
+{
+    send_batch_and_wait(CTX_ARGS &packet, 1, data);
+}
+
+
+/** Sends a batch of targets to the other board, fires them, and collects the results. The
+ *  batch is acknowledged as a whole by the result, and sent again if that is lost.
+*  @param targets Array of positions to probe, sorted in place into the order they are sent in
+*  @param count Number of targets, from 1 to SALVO_MAX
+*  @param sunk Set to the number of ships sunk by the salvo
+*  @return Bitmask of which targets were hits, bit 0 being the first target once sorted */
+uint8_t salvo_request(CTX_PARAMS tinygl_point_t* targets, uint8_t count, uint8_t* sunk)
+{
+    // The other board keeps the targets in increasing order of their request bytes, and flags
+    // the hits in that order
+    uint8_t packets[SALVO_MAX + 1];
+    for (uint8_t i = 0; i < count; i++) {
+        tinygl_point_t target = targets[i];
+        uint8_t packet = REQUEST_HEADER | (target.x << X_SHIFT) | target.y;
+        uint8_t j = i;
+        while (j > 0 && packets[j - 1] > packet) {
+            packets[j] = packets[j - 1];
+            targets[j] = targets[j - 1];
+            j--;
+        }
+        packets[j] = packet;
+        targets[j] = target;
+    }
+    packets[count] = SALVO_FIRE | (ctx->link.salvo_seq ? SALVO_FIRE_SEQ_BIT : 0) | (count - 1);
+    ctx->link.salvo_seq = !ctx->link.salvo_seq;
+
+    uint8_t response;
+    send_batch_and_wait(CTX_ARGS packets, count + 1, &response);
+    while (response == SALVO_RESEND) {
+        send_batch_and_wait(CTX_ARGS packets, count + 1, &response);
+    }
+
+    *sunk = (response & SALVO_SUNK_BITMASK) >> SALVO_SUNK_SHIFT;
+    return response & SALVO_HITS_BITMASK;
+}
+
+
 /** Sends an initialiser packet to the other board to state we are ready to begin the game, wait
  *  for an acknowledgement.
  *  @return The state of the game to enter when the second player is ready */
-GameState_t send_init(void)
+GameState_t send_init(CTX_PARAM)
 {
-    send_and_wait(INIT_READY, NULL);
+    ctx->link.peer_ready = false;
+    ctx->link.ready_answer = INIT_READY_ACK;
+    ctx->link.last_request = NO_REQUEST;
+    ctx->link.last_salvo = NO_REQUEST;
+    ctx->link.salvo_count = 0;
+    ctx->link.turn_received = false;
+
+    // Commit to our fleet first, so the other board has it by the time it sees INIT_READY
+    uint8_t commitment[COMMIT_BYTES];
+    verify_get_commitment(CTX_ARGS commitment);
+    send_stream(CTX_ARGS commitment, COMMIT_BYTES);
+
+    uint8_t response;
+    send_and_wait(CTX_ARGS INIT_READY, &response);
+    while (response == INIT_READY_RESEND) {
+        send_stream(CTX_ARGS commitment, COMMIT_BYTES);
+        send_and_wait(CTX_ARGS INIT_READY, &response);
+    }
+
+    // If the other board declared itself ready while we did, both finished setup together
+    // and neither is waiting for the other. The commitments decide who goes first, unless
+    // it had finished before our INIT_READY arrived and has taken the first turn.
+    if (response != INIT_READY_WAITING && ctx->link.peer_ready && verify_goes_first_p(CTX_ARG)) {
+        return ATTACK;
+    }
     return WAIT;
 }
 
 
+/** Send a block of bytes to the other board, one nibble per packet. Each packet is
+ *  acknowledged before the next is sent.
+*  @param bytes The bytes to send
+*  @param length Number of bytes to send
+*  @note This is a blocking function, the display will freeze until the whole block is sent */
+void send_stream(CTX_PARAMS const uint8_t* bytes, uint8_t length)
+{
+    for (uint8_t i = 0; i < 2 * length; i++) {
+        uint8_t seq = i & 1;
+        uint8_t nibble = bytes[i >> 1];
+        if (seq) {
+            nibble >>= DATA_NIBBLE_SHIFT;
+        }
+
+        uint8_t packet = DATA_HEADER | (seq ? DATA_SEQ_BIT : 0) | (nibble & DATA_BITMASK);
+        uint8_t response;
+        send_and_wait(CTX_ARGS packet, &response);
+    }
+}
+
+
+/** Wait for a block of bytes sent by the other board with send_stream.
+*  @param bytes Buffer to store the bytes in
+*  @param length Number of bytes to receive, at most REVEAL_BYTES
+*  @note This is a blocking function, the display will freeze until the whole block arrives */
+void receive_stream(CTX_PARAMS uint8_t* bytes, uint8_t length)
+{
+    while (ctx->link.stream_nibbles < 2 * length) {
+        uint8_t data = 0;
+        ir_serial_ret_t ret = link_poll(CTX_ARGS &data);
+        ctx->link.link_stats.blocked_ticks++;
+        if (ret == IR_SERIAL_OK) {
+            handle_packet(CTX_ARGS data);
+        } else if (ret < 0) {
+            ctx->link.link_stats.invalid_bytes++;
+        }
+    }
+
+    for (uint8_t i = 0; i < length; i++) {
+        bytes[i] = ctx->link.stream_buffer[i];
+    }
+    ctx->link.stream_nibbles = 0;
+}
+
+
+/** Swap fleet layouts with the other board at the end of the game, and check theirs against
+ *  the commitment it sent at the start. The loser reveals first while the winner listens.
+*  @param winner Whether this player won the game
+*  @return VERIFY_HONEST if the other board answered every shot honestly, VERIFY_CHEATED if
+*          not, or VERIFY_UNVERIFIED if its commitment never arrived */
+VerifyResult_t exchange_reveal(CTX_PARAMS bool winner)
+{
+    uint8_t own[REVEAL_BYTES];
+    uint8_t theirs[REVEAL_BYTES];
+    verify_get_reveal(CTX_ARGS own);
+
+    if (winner) {
+        receive_stream(CTX_ARGS theirs, REVEAL_BYTES);
+        send_stream(CTX_ARGS own, REVEAL_BYTES);
+    } else {
+        send_stream(CTX_ARGS own, REVEAL_BYTES);
+        receive_stream(CTX_ARGS theirs, REVEAL_BYTES);
+    }
+    return verify_check_reveal(CTX_ARGS theirs);
+}
+
+
 /** Periodically check for incoming IR packets in the paced loop, and react accordingly.
-*  @return Whether a packet was received*/
-bool check_for_request(void) {
+*  @return Whether the other board has taken a new turn since the last check, so it's ours */
+bool check_for_request(CTX_PARAM) {
     // Check whether a response needs to be sent while in wait phase
-    // Returns true if a request was responded to
-    static ir_serial_ret_t ret = IR_SERIAL_NONE;
     uint8_t data = 0;
 
-    ret = ir_serial_receive(&data);
-    if (ret == IR_SERIAL_OK){
-        ret = IR_SERIAL_NONE;
-        //ir_serial_transmit(RESPONSE_HIT);
-        // Check this is an incoming packet before processing further, in an attempt to avoid crosstalk
-        if ((data >> HEADER_SHIFT) == REQUEST_HEADER) {
-            tinygl_point_t cursor_position = {(data & X_BITMASK) >> X_SHIFT, data & Y_BITMASK};
-            hit_response(&cursor_position);
-            return true;
-        } else if (data == INIT_READY) {
-            ir_serial_transmit(INIT_READY_ACK);
-        }
+    ir_serial_ret_t ret = link_receive(CTX_ARGS &data);
+    if (ret == IR_SERIAL_OK) {
+        handle_packet(CTX_ARGS data);
+    } else if (ret < 0) {
+        ctx->link.link_stats.invalid_bytes++;
     }
-    return false;
+
+    // The turn may also have been taken while we were blocked on a request of our own
+    bool turn = ctx->link.turn_received;
+    ctx->link.turn_received = false;
+    return turn;
+}
+
+
+/** Get the statistics collected on the IR link since power on.
+*  @param stats Structure to fill with the statistics */
+void get_link_stats(CTX_PARAMS link_stats_t* stats)
+{
+    *stats = ctx->link.link_stats;
+}
+
+
+/** Transmit a little endian value to a listening host one nibble at a time, as export packets.
+*  @param value The value to send
+*  @param bytes Number of bytes of the value to send */
+void export_value(uint32_t value, uint8_t bytes)
+{
+    for (uint8_t i = 0; i < 2 * bytes; i++) {
+        ir_serial_transmit(EXPORT_HEADER | (value & DATA_BITMASK));
+        value >>= DATA_NIBBLE_SHIFT;
+    }
+}
+
+
+/** Send the link statistics to a listening host, in the order of the fields of link_stats_t,
+ *  least significant nibble first. Nothing is acknowledged, so this doesn't block on the
+ *  other board. */
+void export_link_stats(CTX_PARAM)
+{
+    link_stats_t* stats = &ctx->link.link_stats;
+
+    ir_serial_transmit(EXPORT_START);
+    export_value(stats->requests, sizeof(stats->requests));
+    export_value(stats->rtt_last, sizeof(stats->rtt_last));
+    export_value(stats->rtt_max, sizeof(stats->rtt_max));
+    export_value(stats->rtt_total, sizeof(stats->rtt_total));
+    export_value(stats->retransmits, sizeof(stats->retransmits));
+    export_value(stats->retransmits_max, sizeof(stats->retransmits_max));
+    export_value(stats->invalid_bytes, sizeof(stats->invalid_bytes));
+    export_value(stats->out_of_place_bytes, sizeof(stats->out_of_place_bytes));
+    export_value(stats->blocked_ticks, sizeof(stats->blocked_ticks));
+}
+
+
+/** Work out the answer to a shot at this players board, counting it if it's a new hit.
+*  @param cursor_position The position of the shot
+*  @return RESPONSE_MISS, RESPONSE_HIT, or RESPONSE_SUNK with the sunk ship index */
+static uint8_t resolve_shot(CTX_PARAMS tinygl_point_t* cursor_position)
+{
+    uint8_t* cell = &ctx->link.fleet_map[cursor_position->y][cursor_position->x];
+
+    // Check if hit or miss
+    if (*cell == FLEET_CELL_EMPTY) {
+        return RESPONSE_MISS;
+    }
+
+    uint8_t ship = *cell & ~FLEET_CELL_HIT;
+    if (!(*cell & FLEET_CELL_HIT)) {
+        // Only count the first hit on a cell, a repeat is a request resent after a lost response
+        *cell |= FLEET_CELL_HIT;
+        ctx->link.ship_hits[ship]++;
+        increment_oponent_hits(CTX_ARG);
+    }
+
+    if (ctx->link.ship_hits[ship] == ctx->link.ship_length[ship]) {
+        return RESPONSE_SUNK | ship;
+    }
+    return RESPONSE_HIT;
 }
 
 
 /** Send a response to a hit_request packet
 *  @param cursor_position The cursor position received in the hit_request packet */
-void hit_response(tinygl_point_t* cursor_position)
+void hit_response(CTX_PARAMS tinygl_point_t* cursor_position)
 {
-    // Check if hit or miss
-    if (remote_is_hit(*cursor_position)) {
-    //if (cursor_position->x == 6 && cursor_position->y == 0) {
-        ir_serial_transmit(RESPONSE_HIT);
-        increment_oponent_hits();
-    } else {
-        ir_serial_transmit(RESPONSE_MISS);
+    link_transmit(CTX_ARGS resolve_shot(CTX_ARGS cursor_position));
+}
+
+
+/** Answer a SALVO_FIRE packet, resolving the targets received before it. A resend of the
+ *  last one answered gets the same answer, and one with targets missing is refused.
+*  @param fire The SALVO_FIRE packet received */
+void salvo_response(CTX_PARAMS uint8_t fire)
+{
+    uint8_t count = ctx->link.salvo_count;
+    ctx->link.salvo_count = 0;
+
+    if (fire != ctx->link.last_salvo) {
+        if (count != (fire & SALVO_FIRE_COUNT_BITMASK) + 1) {
+            link_transmit(CTX_ARGS SALVO_RESEND);
+            return;
+        }
+
+        ctx->link.last_salvo = fire;
+        ctx->link.turn_received = true;
+        uint8_t hits = 0;
+        uint8_t sunk = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            tinygl_point_t target = {(ctx->link.salvo_targets[i] & X_BITMASK) >> X_SHIFT, 
+                                     ctx->link.salvo_targets[i] & Y_BITMASK};
+            uint8_t response = resolve_shot(CTX_ARGS &target);
+            if (response != RESPONSE_MISS) {
+                hits |= (1 << i);
+            }
+            if ((response & ~SHIP_BITMASK) == RESPONSE_SUNK) {
+                sunk++;
+            }
+        }
+        ctx->link.salvo_result = SALVO_RESULT | (sunk << SALVO_SUNK_SHIFT) | hits;
     }
+    link_transmit(CTX_ARGS ctx->link.salvo_result);
 }
\ No newline at end of file
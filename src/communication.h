@@ -13,6 +13,7 @@
 #include "ir_serial.h"
 #include "tinygl.h"
 #include "gamestate.h"
+#include "context.h"
 
 /* We'll define a packet format. 
 
@@ -24,15 +25,86 @@ X and Y: data
     - x and y position for a hit request,
     - both 0x111 for a sucessful hit response
     - both 0x000 for a unsuccessful hit response
+    - 0x000 and the sunk ship index for a hit that sinks a ship
     - unused for a game initialiser
+
+Blocks of data, such as the fleet commitment and reveal, are sent one nibble per packet
+with type 0x01. Bit 4 is an alternating sequence bit and bits 0-3 are the nibble.
+A board waiting on an answer still acknowledges data packets and INIT_READY, so two boards 
+that finish setup together stream their commitments to each other at once. The lower
+commitment then attacks first. A board that had already finished answers with
+INIT_READY_WAITING instead, and attacks first, as the other board may have seen its INIT_READY
+without it seeing theirs. INIT_READY is only acknowledged once the whole commitment has
+arrived. Otherwise it is answered with INIT_READY_RESEND, and the commitment is sent again.
+
+Every packet that expects an answer is sent again if the answer is later than a few worst case
+round trips, as either may have been lost. Only an answer of the kind the packet expects is
+accepted, such as the acknowledgement with the same sequence bit, so a late answer to an 
+earlier packet isn't taken for it. The bit rate on air is fixed inside ir_serial.
+
+A hit request the same as the last one answered is a resend, after our answer was lost. It is
+answered again but not counted as the other board's next shot, as the cursor never fires at
+the same cell twice. A new request answered while waiting on our own counts all the same.
+
+In the salvo variant, the targets are sent one per byte in the request format, without
+waiting for an answer to each, then SALVO_FIRE is answered with SALVO_RESULT. Bits 0-1 of 
+SALVO_FIRE give the number of targets less one and bit 2 alternates from one salvo to the next.
+Bits 0-2 of the result flag which targets hit, in the order of their request bytes, and bits 
+3-4 count the ships sunk by the salvo. The targets are sent in increasing order, and the
+defender keeps them that way, so a batch that is sent again lines up with what arrived first. 
+If fewer targets arrived than SALVO_FIRE counts, it is answered with SALVO_RESEND, and the 
+whole batch is sent again. The defender answers a resent SALVO_FIRE with the same result, 
+even once it's busy with its own turn.
+
+Telemetry is exported to a listening host with EXPORT_START, or TRACE_START for the event
+trace, then one EXPORT_HEADER packet per nibble. These aren't acknowledged, and are ignored by the other board.
 */
 
 #define X_BITMASK 0x38
 #define Y_BITMASK 0x07
 #define X_SHIFT 0x03
 #define Y_SHIFT 0x03
-#define HEADER_SHIFT 8
+#define SHIP_BITMASK 0x07
+#define HEADER_SHIFT 6
 #define NUM_OF_ROWS 7
+#define NUM_COLS 5
+#define DATA_SEQ_BIT 0x10
+#define DATA_BITMASK 0x0F
+#define DATA_NIBBLE_SHIFT 4
+#define DATA_ACK_SEQ 0x01
+#define EXPORT_BITMASK 0x1F
+#define SALVO_BITMASK 0x1F
+#define SALVO_HITS_BITMASK 0x07
+#define SALVO_SUNK_BITMASK 0x18
+#define SALVO_SUNK_SHIFT 3
+#define SALVO_MAX NUM_SHIPS
+#define SALVO_FIRE_BITMASK 0x07
+#define SALVO_FIRE_COUNT_BITMASK 0x03
+#define SALVO_FIRE_SEQ_BIT 0x04
+
+// Goodput is reported in requests answered per this many ticks blocked on the link, i.e. per 
+// second at a PACER_RATE of 500
+#define LINK_GOODPUT_TICKS 500
+
+// Build with -DSALVO_MODE=1 for the salvo variant, where each turn fires one shot per 
+// surviving ship. Both boards must be built the same way.
+#ifndef SALVO_MODE
+#define SALVO_MODE 0
+#endif
+#define NUM_SHIPS 3
+#define NO_SHIP 0xFF
+#define NO_REQUEST 0xFF
+
+/* The outcome of checking the other board's fleet at the end of the game. A fleet can't be
+   checked if its commitment never arrived, which says nothing about the other board. */
+typedef enum {
+    VERIFY_HONEST = 0,
+    VERIFY_UNVERIFIED,
+    VERIFY_CHEATED
+} VerifyResult_t;
+
+// Lengths of the ships in the fleet, in the order they are placed
+#define FLEET_SHIP_LENGTHS {3, 3, 2}
 
 typedef enum {
     REQUEST_HEADER = 0x00,
@@ -44,45 +116,146 @@ typedef enum {
 typedef enum {
     RESPONSE_HIT = 0xFF,
     RESPONSE_MISS = 0x80,
+    RESPONSE_SUNK = 0xC0, // Sunk ship index in the lower bits
     INIT_READY = 0x7F,
-    INIT_READY_ACK = 0xBF
+    INIT_READY_ACK = 0xBF,
+    INIT_READY_RESEND = 0xBE, // INIT_READY refused, as the commitment before it didn't all arrive
+    INIT_READY_WAITING = 0xBC, // INIT_READY acknowledged by a board already waiting, which attacks first
+    DATA_HEADER = 0x40, // Sequence bit and nibble in the lower bits
+    DATA_ACK = 0xA0, // Sequence bit of the acknowledged packet in the lowest bit
+    EXPORT_HEADER = 0x60, // Nibble in the lower bits
+    EXPORT_START = 0x70,
+    TRACE_START = 0x71,
+    SALVO_FIRE = 0x78, // Sequence bit and number of targets less one in the lower bits
+    SALVO_RESULT = 0xE0, // Hit flags and sunk count in the lower bits
+    SALVO_RESEND = 0xBD // SALVO_FIRE refused, as some of the targets before it didn't arrive
 } PredefinedMessages_t;
 
+/* Running statistics on the IR link. Times are in ticks of the paced loop. */
+typedef struct {
+    uint16_t requests;
+    uint16_t rtt_last;
+    uint16_t rtt_max;
+    uint32_t rtt_total;
+    uint16_t retransmits;
+    uint16_t retransmits_max;
+    uint16_t invalid_bytes;
+    uint16_t out_of_place_bytes;
+    uint32_t blocked_ticks;
+} link_stats_t;
+
+// The longest block sent with send_stream, the fleet reveal (REVEAL_BYTES in verify.h)
+#define STREAM_MAX_BYTES (NUM_SHIPS + 4)
+
+/* This players fleet and the state of the IR link, part of game_context_t. Each cell of
+   fleet_map holds the index of the ship covering it, or FLEET_CELL_EMPTY. FLEET_CELL_HIT
+   is set once the opponent has hit that cell. */
+typedef struct {
+    uint8_t fleet_map[NUM_OF_ROWS][NUM_COLS];
+    uint8_t ship_length[NUM_SHIPS];
+    uint8_t ship_hits[NUM_SHIPS];
+    uint8_t stream_buffer[STREAM_MAX_BYTES]; // Incoming data stream, two nibbles per byte
+    uint8_t stream_nibbles;
+    bool peer_ready; // The other board has sent INIT_READY since we started send_init
+    uint8_t ready_answer; // INIT_READY_ACK, or INIT_READY_WAITING once we've taken the first turn
+    uint8_t last_request; // The last hit request answered this game, or NO_REQUEST
+    bool turn_received; // The other board has taken a turn that check_for_request hasn't reported
+    uint8_t salvo_targets[SALVO_MAX]; // Request bytes of the incoming salvo, in increasing order
+    uint8_t salvo_count; // More than SALVO_MAX if more targets arrived than any salvo holds
+    uint8_t last_salvo; // The last SALVO_FIRE answered this game, or NO_REQUEST
+    uint8_t salvo_result;
+    bool salvo_seq; // Sequence bit of our next SALVO_FIRE
+    link_stats_t link_stats;
+} link_context_t;
+
+#define LINK_CONTEXT_INIT {.ready_answer = INIT_READY_ACK, .last_request = NO_REQUEST, \
+                           .last_salvo = NO_REQUEST, .salvo_result = SALVO_RESULT}
+
 
 /** Returns whether a position is a hit against this players boat
  *  @param position The position of the boat
  *  @return Whether that position contains a boat */
-bool remote_is_hit(tinygl_point_t position);
+bool remote_is_hit(CTX_PARAMS tinygl_point_t position);
 
 
-/** Stores a list of boat positions locally, for transferring from setup.c 
-*  to communication.c
- *  @param positions Array of position vectors */
-void store_own_boats(tinygl_point_t* positions);
+/** Stores this players boats locally, for transferring from setup.c to communication.c
+ *  @param starts Array of the first cell of each boat
+ *  @param ends Array of the last cell of each boat
+ *  @param count Number of boats in the arrays */
+void store_own_boats(CTX_PARAMS tinygl_point_t* starts, tinygl_point_t* ends, uint8_t count);
 
 /** Sends a hit request packet over IR to the other board.
 *  @param position Position to probe
+*  @param sunk_ship Set to the index of the ship sunk by this hit, or NO_SHIP
 *  @return Whether the response was a hit */
-bool hit_request(tinygl_point_t* cursor_position);
+bool hit_request(CTX_PARAMS tinygl_point_t* cursor_position, uint8_t* sunk_ship);
 
-/** Sends a packet and wait for a response.
+/** Sends a batch of targets to the other board, fires them, and collects the results. The
+ *  batch is acknowledged as a whole by the result, and sent again if that is lost.
+*  @param targets Array of positions to probe, sorted in place into the order they are sent in
+*  @param count Number of targets, from 1 to SALVO_MAX
+*  @param sunk Set to the number of ships sunk by the salvo
+*  @return Bitmask of which targets were hits, bit 0 being the first target once sorted */
+uint8_t salvo_request(CTX_PARAMS tinygl_point_t* targets, uint8_t count, uint8_t* sunk);
+
+/** Sends a packet and wait for a response, resending it until an answer of the kind it
+ *  expects arrives.
 *  @param packet The data packet to send
 *  @param data A pointer to a uint8_t to store the response
 *  @note This is a blocking function, the display will freeze until we receive a response */
-void send_and_wait(uint8_t packet, uint8_t* data);
+void send_and_wait(CTX_PARAMS uint8_t packet, uint8_t* data);
 
 /** Sends an initialiser packet to the other board to state we are ready to begin the game, wait
  *  for an acknowledgement.
  *  @return The state of the game to enter when the second player is ready */
-GameState_t send_init(void);
+GameState_t send_init(CTX_PARAM);
+
+/** Send a block of bytes to the other board, one nibble per packet. Each packet is
+ *  acknowledged before the next is sent.
+*  @param bytes The bytes to send
+*  @param length Number of bytes to send
+*  @note This is a blocking function, the display will freeze until the whole block is sent */
+void send_stream(CTX_PARAMS const uint8_t* bytes, uint8_t length);
+
+/** Wait for a block of bytes sent by the other board with send_stream.
+*  @param bytes Buffer to store the bytes in
+*  @param length Number of bytes to receive, at most REVEAL_BYTES
+*  @note This is a blocking function, the display will freeze until the whole block arrives */
+void receive_stream(CTX_PARAMS uint8_t* bytes, uint8_t length);
+
+/** Swap fleet layouts with the other board at the end of the game, and check theirs against
+ *  the commitment it sent at the start. The loser reveals first while the winner listens.
+*  @param winner Whether this player won the game
+*  @return VERIFY_HONEST if the other board answered every shot honestly, VERIFY_CHEATED if
+*          not, or VERIFY_UNVERIFIED if its commitment never arrived */
+VerifyResult_t exchange_reveal(CTX_PARAMS bool winner);
 
 /** Send a response to a hit_request packet
 *  @param cursor_position The cursor position received in the hit_request packet */
-void hit_response(tinygl_point_t* cursor_position);
+void hit_response(CTX_PARAMS tinygl_point_t* cursor_position);
+
+/** Answer a SALVO_FIRE packet, resolving the targets received before it. A resend of the
+ *  last one answered gets the same answer, and one with targets missing is refused.
+*  @param fire The SALVO_FIRE packet received */
+void salvo_response(CTX_PARAMS uint8_t fire);
 
 /** Periodically check for incoming IR packets in the paced loop, and react accordingly.
-*  @return Whether a packet was received*/
-bool check_for_request(void);
+*  @return Whether the other board has taken a new turn since the last check, so it's ours */
+bool check_for_request(CTX_PARAM);
+
+/** Get the statistics collected on the IR link since power on.
+*  @param stats Structure to fill with the statistics */
+void get_link_stats(CTX_PARAMS link_stats_t* stats);
+
+/** Transmit a little endian value to a listening host one nibble at a time, as export packets.
+*  @param value The value to send
+*  @param bytes Number of bytes of the value to send */
+void export_value(uint32_t value, uint8_t bytes);
+
+/** Send the link statistics to a listening host, in the order of the fields of link_stats_t,
+ *  least significant nibble first. Nothing is acknowledged, so this doesn't block on the
+ *  other board. */
+void export_link_stats(CTX_PARAM);
 
-void reset_hits(void);
+void reset_hits(CTX_PARAM);
 #endif
\ No newline at end of file
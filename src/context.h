@@ -0,0 +1,49 @@
+/**
+  @file context.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Passing the game context to the functions that use it. Everything a game keeps
+         between ticks lives in a game_context_t (see game_context.h) rather than in statics,
+         so that several games can share one address space.
+ */
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "system.h"
+
+typedef struct game_context game_context_t;
+
+/* Functions taking the context are declared with CTX_PARAM, or CTX_PARAMS before their other
+   parameters, and called with CTX_ARG or CTX_ARGS. In the function body the context is ctx.
+
+   On the board there is only ever one game, so by default ctx is a constant pointer to the 
+   single game_context, declared below. Nothing is passed, and the compiler folds every access
+   to a fixed address exactly as with statics, so this costs no code space. Build with 
+   -DGAME_CONTEXT_PARAM=1 to pass ctx as a real parameter instead, to run many games in one
+   process on a host. host/ has such a build, which supplies its own main and drivers, with 
+   the driver state kept per board. */
+#ifndef GAME_CONTEXT_PARAM
+#define GAME_CONTEXT_PARAM 0
+#endif
+
+#if GAME_CONTEXT_PARAM
+
+#define CTX_PARAM game_context_t* ctx
+#define CTX_PARAMS game_context_t* ctx,
+#define CTX_ARG ctx
+#define CTX_ARGS ctx,
+
+#else
+
+#define CTX_PARAM void
+#define CTX_PARAMS
+#define CTX_ARG
+#define CTX_ARGS
+
+extern game_context_t game_context;
+static game_context_t* const ctx = &game_context;
+
+#endif // GAME_CONTEXT_PARAM
+
+#endif // CONTEXT_H
@@ -12,22 +12,111 @@
 #include "pacer.h"
 #include "tinygl.h"
 #include "navswitch.h"
-#include "../fonts/font5x5_1_r.h"
 #include "gamestate.h"
 #include "message.h"
 #include "communication.h"
+#include "shade.h"
+#include "input.h"
+#include "random.h"
+#include "timer.h"
+#include "trace.h"
+#include "wheel.h"
+#include "game.h"
+#include "game_context.h"
 
-#define PACER_RATE 500
 #define TEXT_RATE 10
+#define SCAN_TIMER_TICKS (TIMER_RATE / DISPLAY_RATE)
+
+
+/** Run one tick of the game, once the display has been scanned and the pacer has released
+ *  us. Blocking exchanges with the other board keep scanning the display within the tick.
+    @param game_state The current game state
+    @return The next game state */
+GameState_t game_step(CTX_PARAMS GameState_t game_state)
+{
+    timer_tick_t tick_start = timer_get();
+    GameState_t previous_state = game_state;
+
+    // Whatever jitter there is in when the pacer releases us helps seed the random numbers
+    random_add_entropy(CTX_ARGS tick_start);
+
+    // Expire timers before the game state runs, so anything they change is drawn this tick
+    wheel_update(CTX_ARG);
+
+    // Switch to the correct game state based on the return of the current game state
+    switch (game_state) {
+        case SETUP:
+            game_state = set(CTX_ARG);
+            break;
+        case ATTACK:
+            game_state = attack(CTX_ARG);
+            break;
+        case WAIT:
+            game_state = wait(CTX_ARG);
+            break;
+        case HIT:
+            game_state = hit(CTX_ARG);
+            break;
+        case MISS:
+            game_state = miss(CTX_ARG);
+            break;
+        case SUNK:
+            game_state = sunk(CTX_ARG);
+            break;
+        case SALVO:
+            game_state = salvo_summary(CTX_ARG);
+            break;
+        case WIN:
+            game_state = win(CTX_ARG);
+            reset_boats(CTX_ARG);
+            reset_hits(CTX_ARG);
+            break;
+        case LOSS:
+            game_state = loss(CTX_ARG);
+            reset_boats(CTX_ARG);
+            reset_hits(CTX_ARG);
+            break;
+    }
+
+    if (game_state != previous_state) {
+        TRACE_EVENT(TRACE_STATE, game_state);
+    }
+
+    navswitch_update();
+    input_update(CTX_ARG);
+
+#if TRACE
+    // Log ticks that held up the next scan of the display
+    timer_tick_t elapsed = timer_get() - tick_start;
+    if (elapsed > SCAN_TIMER_TICKS) {
+        elapsed -= SCAN_TIMER_TICKS;
+        TRACE_EVENT(TRACE_OVERRUN, elapsed > UINT8_MAX ? UINT8_MAX : elapsed);
+    }
+#endif
+    return game_state;
+}
+
+
+#if GAME_MAIN
+
+#include "../fonts/font5x5_1_r.h"
+
+// The one game this board plays
+game_context_t game_context = GAME_CONTEXT_INIT;
 
 int main (void)
 { 
+#if GAME_CONTEXT_PARAM
+    game_context_t* const ctx = &game_context;
+#endif
+
     // Initialise external modules
     system_init();
-    tinygl_init(PACER_RATE);
-    pacer_init(PACER_RATE);
+    tinygl_init(DISPLAY_RATE);
+    pacer_init(DISPLAY_RATE);
     tinygl_font_set(&font5x5_1_r);
     ir_serial_init ();
+    input_init(CTX_ARG);
 
     // Set the initial game state to the "SETUP" state
     GameState_t game_state = SETUP;
@@ -35,39 +124,12 @@ int main (void)
     // Paced loop
     while (1)
     {
-        pacer_wait();
-
-        // Switch to the correct game state based on the return of the current game state
-        switch (game_state) {
-            case SETUP:
-                game_state = set();
-                break;
-            case ATTACK:
-                game_state = attack();
-                break;
-            case WAIT:
-                game_state = wait();
-                break;
-            case HIT:
-                game_state = hit();
-                break;
-            case MISS:
-                game_state = miss();
-                break;
-            case WIN:
-                game_state = win();
-                reset_boats();
-                reset_hits();
-                break;
-            case LOSS:
-                game_state = loss();
-                reset_boats();
-                reset_hits();
-                break;
+        // Scan the display while waiting for the next tick
+        if (shade_tick(CTX_ARG)) {
+            input_frame_started(CTX_ARG);
         }
-
-        tinygl_update();
-        navswitch_update();
-        
+        game_state = game_step(CTX_ARGS game_state);
     }   
 }
+
+#endif // GAME_MAIN
@@ -0,0 +1,32 @@
+/**
+  @file game.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief The paced loop that runs the game. game.c also has the board's main, which a host
+         build leaves out with GAME_MAIN=0 to drive game_step itself.
+ */
+
+#ifndef GAME_H
+#define GAME_H
+
+#include "system.h"
+#include "gamestate.h"
+#include "shade.h"
+#include "context.h"
+
+// Build with -DGAME_MAIN=0 to leave out main and the board's game_context
+#ifndef GAME_MAIN
+#define GAME_MAIN 1
+#endif
+
+// Ticks of the game per second, and scans of the display per second
+#define PACER_RATE 500
+#define DISPLAY_RATE (PACER_RATE * SHADE_SCANS_PER_TICK)
+
+/** Run one tick of the game, once the display has been scanned and the pacer has released
+ *  us. Blocking exchanges with the other board keep scanning the display within the tick.
+    @param game_state The current game state
+    @return The next game state */
+GameState_t game_step(CTX_PARAMS GameState_t game_state);
+
+#endif // GAME_H
@@ -0,0 +1,52 @@
+/**
+  @file game_context.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief The state of one game, gathered from every module. See context.h.
+ */
+
+#ifndef GAME_CONTEXT_H
+#define GAME_CONTEXT_H
+
+#include "system.h"
+#include "context.h"
+#include "setup.h"
+#include "attack.h"
+#include "message.h"
+#include "communication.h"
+#include "verify.h"
+#include "random.h"
+#include "input.h"
+#include "shade.h"
+#include "sprite.h"
+#include "telemetry.h"
+#include "wheel.h"
+#include "trace.h"
+
+struct game_context {
+    setup_context_t setup;
+    attack_context_t attack;
+    message_context_t message;
+    link_context_t link;
+    verify_context_t verify;
+    random_context_t random;
+    input_context_t input;
+    shade_context_t shade;
+    sprite_context_t sprite;
+    telemetry_context_t telemetry;
+    wheel_context_t wheel;
+#if TRACE
+    trace_context_t trace;
+#endif
+};
+
+// Everything else starts at zero
+#define GAME_CONTEXT_INIT { \
+    .setup = SETUP_CONTEXT_INIT, \
+    .attack = ATTACK_CONTEXT_INIT, \
+    .message = MESSAGE_CONTEXT_INIT, \
+    .link = LINK_CONTEXT_INIT, \
+    .random = RANDOM_CONTEXT_INIT \
+}
+
+#endif // GAME_CONTEXT_H
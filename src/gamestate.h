@@ -14,6 +14,8 @@ typedef enum {
     WAIT,
     HIT,
     MISS,
+    SUNK,
+    SALVO,
     WIN,
     LOSS
 } GameState_t;
@@ -0,0 +1,196 @@
+/**
+  @file input.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Navswitch input with debouncing and hold-to-repeat, plus instrumentation of the
+         latency between a navswitch event and the updated frame reaching the display.
+ */
+
+#include "system.h"
+#include "navswitch.h"
+#include "input.h"
+#include "random.h"
+#include "trace.h"
+#include "game_context.h"
+
+// All times are in ticks of the paced loop, i.e. 2ms at a PACER_RATE of 500.
+#define DEBOUNCE_TICKS 10
+#define REPEAT_DELAY 200
+#define REPEAT_INTERVAL 100
+#define REPEAT_MIN_INTERVAL 30
+#define REPEAT_ACCELERATION 20
+#define LONG_PUSH_TICKS 500
+
+typedef enum {
+    LATENCY_IDLE = 0,
+    LATENCY_PENDING,
+    LATENCY_RENDERING
+} LatencyState_t;
+
+/** Reset the repeat and latency state. */
+void input_init(CTX_PARAM)
+{
+    for (uint8_t i = 0; i < INPUT_NUM_BUTTONS; i++) {
+        ctx->input.held_time[i] = 0;
+        ctx->input.repeat_interval[i] = REPEAT_DELAY;
+        ctx->input.lockout[i] = 0;
+    }
+    ctx->input.events = 0;
+    ctx->input.long_push = false;
+    ctx->input.short_push = false;
+    ctx->input.push_pending = false;
+    ctx->input.latency_state = LATENCY_IDLE;
+    ctx->input.latency = (input_latency_t){0};
+}
+
+
+/** Work out whether a single button has an event this tick.
+    @param button One of the NAVSWITCH_ buttons
+    @return Whether there was an event */
+static bool button_update(CTX_PARAMS uint8_t button)
+{
+    if (ctx->input.lockout[button] > 0) {
+        // Ignore contact bounce for a short time after each event
+        ctx->input.lockout[button]--;
+        navswitch_push_event_p(button);
+    } else if (navswitch_push_event_p(button)) {
+        ctx->input.held_time[button] = 0;
+        ctx->input.repeat_interval[button] = REPEAT_DELAY;
+        ctx->input.lockout[button] = DEBOUNCE_TICKS;
+        if (button == NAVSWITCH_PUSH) {
+            ctx->input.push_pending = true;
+        }
+        return true;
+    }
+
+    if (!navswitch_down_p(button)) {
+        if (button == NAVSWITCH_PUSH && ctx->input.push_pending 
+            && ctx->input.lockout[button] == 0) {
+            // Only trust a release once contact bounce from the press has settled
+            ctx->input.short_push = true;
+            ctx->input.push_pending = false;
+        }
+        ctx->input.held_time[button] = 0;
+        return false;
+    }
+
+    if (button == NAVSWITCH_PUSH) {
+        // The push button doesn't repeat, it reports a long press once instead
+        if (ctx->input.held_time[button] < LONG_PUSH_TICKS) {
+            ctx->input.held_time[button]++;
+            ctx->input.long_push = (ctx->input.held_time[button] == LONG_PUSH_TICKS);
+            if (ctx->input.long_push) {
+                ctx->input.push_pending = false;
+            }
+        }
+        return false;
+    }
+
+    ctx->input.held_time[button]++;
+    if (ctx->input.held_time[button] >= ctx->input.repeat_interval[button]) {
+        // Repeat, and shorten the interval until the next repeat
+        ctx->input.held_time[button] = 0;
+        if (ctx->input.repeat_interval[button] > REPEAT_INTERVAL) {
+            ctx->input.repeat_interval[button] = REPEAT_INTERVAL;
+        } else if (ctx->input.repeat_interval[button] 
+                   >= REPEAT_MIN_INTERVAL + REPEAT_ACCELERATION) {
+            ctx->input.repeat_interval[button] -= REPEAT_ACCELERATION;
+        } else {
+            ctx->input.repeat_interval[button] = REPEAT_MIN_INTERVAL;
+        }
+        return true;
+    }
+    return false;
+}
+
+
+/** Poll the navswitch state and generate events. Must be called once per tick of the
+ *  paced loop, after navswitch_update. */
+void input_update(CTX_PARAM)
+{
+    ctx->input.ticks++;
+    ctx->input.events = 0;
+    ctx->input.long_push = false;
+    ctx->input.short_push = false;
+    for (uint8_t button = 0; button < INPUT_NUM_BUTTONS; button++) {
+        if (button_update(CTX_ARGS button)) {
+            ctx->input.events |= (1 << button);
+        }
+    }
+
+    if (ctx->input.events) {
+        // The tick a player presses on is unpredictable, so feeds the random number generator
+        random_add_entropy(CTX_ARGS ctx->input.ticks);
+        TRACE_EVENT(TRACE_NAVSWITCH, ctx->input.events);
+    }
+
+    // Start timing from the first event, until the frame drawn in response is shown
+    if (ctx->input.events && ctx->input.latency_state == LATENCY_IDLE) {
+        ctx->input.event_tick = ctx->input.ticks;
+        ctx->input.latency_state = LATENCY_PENDING;
+    }
+}
+
+
+/** Check whether a button generated an event this tick. Directions generate an event when
+ *  first pushed, then repeat with acceleration while held. The push button does not repeat.
+    @param button One of the NAVSWITCH_ buttons
+    @return Whether there was an event */
+bool input_event_p(CTX_PARAMS uint8_t button)
+{
+    return (ctx->input.events >> button) & 1;
+}
+
+
+/** Check whether any button generated an event this tick.
+    @return Whether there was an event */
+bool input_any_event_p(CTX_PARAM)
+{
+    return ctx->input.events != 0;
+}
+
+
+/** Check whether the push button has just been released from a press that didn't reach a
+ *  long press. Unlike the push event, this doesn't happen when the press goes on to be long.
+    @return Whether a short press ended this tick */
+bool input_short_push_p(CTX_PARAM)
+{
+    return ctx->input.short_push;
+}
+
+
+/** Check whether the push button has just been held down for a long time. This is reported
+ *  once per press, after the normal push event.
+    @return Whether the push button reached a long press this tick */
+bool input_long_push_p(CTX_PARAM)
+{
+    return ctx->input.long_push;
+}
+
+
+/** Inform the latency probe that a new display frame has started. The previous frame has
+ *  then been completely scanned out. */
+void input_frame_started(CTX_PARAM)
+{
+    if (ctx->input.latency_state == LATENCY_PENDING) {
+        // This frame was drawn after the event was handled
+        ctx->input.latency_state = LATENCY_RENDERING;
+    } else if (ctx->input.latency_state == LATENCY_RENDERING) {
+        // ticks is only advanced later in this tick, by input_update
+        ctx->input.latency.last = ctx->input.ticks + 1 - ctx->input.event_tick;
+        if (ctx->input.latency.last > ctx->input.latency.max) {
+            ctx->input.latency.max = ctx->input.latency.last;
+        }
+        ctx->input.latency.total += ctx->input.latency.last;
+        ctx->input.latency.count++;
+        ctx->input.latency_state = LATENCY_IDLE;
+    }
+}
+
+
+/** Get the input-to-photon latency measured so far.
+    @param result Structure to fill with the statistics */
+void input_latency_get(CTX_PARAMS input_latency_t* result)
+{
+    *result = ctx->input.latency;
+}
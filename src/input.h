@@ -0,0 +1,78 @@
+/**
+  @file input.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Navswitch input with debouncing and hold-to-repeat, plus instrumentation of the
+         latency between a navswitch event and the updated frame reaching the display.
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "system.h"
+#include "navswitch.h"
+#include "context.h"
+
+#define INPUT_NUM_BUTTONS 5
+
+/* Input-to-photon latency statistics, in ticks of the paced loop. */
+typedef struct {
+    uint16_t last;
+    uint16_t max;
+    uint32_t total;
+    uint16_t count;
+} input_latency_t;
+
+/* Navswitch and latency probe state, part of game_context_t. Times are in ticks of the
+   paced loop. */
+typedef struct {
+    uint16_t held_time[INPUT_NUM_BUTTONS];
+    uint16_t repeat_interval[INPUT_NUM_BUTTONS];
+    uint8_t lockout[INPUT_NUM_BUTTONS];
+    uint8_t events;
+    bool long_push;
+    bool short_push;
+    bool push_pending; // Pushed, and neither released nor held long yet
+    uint16_t ticks;
+    uint16_t event_tick;
+    uint8_t latency_state;
+    input_latency_t latency;
+} input_context_t;
+
+
+/** Reset the repeat and latency state. */
+void input_init(CTX_PARAM);
+
+/** Poll the navswitch state and generate events. Must be called once per tick of the
+ *  paced loop, after navswitch_update. */
+void input_update(CTX_PARAM);
+
+/** Check whether a button generated an event this tick. Directions generate an event when
+ *  first pushed, then repeat with acceleration while held. The push button does not repeat.
+    @param button One of the NAVSWITCH_ buttons
+    @return Whether there was an event */
+bool input_event_p(CTX_PARAMS uint8_t button);
+
+/** Check whether any button generated an event this tick.
+    @return Whether there was an event */
+bool input_any_event_p(CTX_PARAM);
+
+/** Check whether the push button has just been released from a press that didn't reach a
+ *  long press. Unlike the push event, this doesn't happen when the press goes on to be long.
+    @return Whether a short press ended this tick */
+bool input_short_push_p(CTX_PARAM);
+
+/** Check whether the push button has just been held down for a long time. This is reported
+ *  once per press, after the normal push event.
+    @return Whether the push button reached a long press this tick */
+bool input_long_push_p(CTX_PARAM);
+
+/** Inform the latency probe that a new display frame has started. The previous frame has
+ *  then been completely scanned out. */
+void input_frame_started(CTX_PARAM);
+
+/** Get the input-to-photon latency measured so far.
+    @param result Structure to fill with the statistics */
+void input_latency_get(CTX_PARAMS input_latency_t* result);
+
+#endif // INPUT_H
@@ -10,130 +10,139 @@
 #include "tinygl.h"
 #include "gamestate.h"
 #include "communication.h"
+#include "attack.h"
+#include "sprite.h"
+#include "telemetry.h"
+#include "input.h"
+#include "verify.h"
+#include "game_context.h"
+
+
+/** Answer the other board while the outcome of our last shot is shown, so their next shot
+    isn't held up until it finishes. If they have already fired, it's our turn again, and
+    any navswitch event skips the rest of the outcome.
+    @param finished Whether the outcome has been shown in full
+    @param state The state showing the outcome
+    @return The next game state */
+GameState_t outcome_update(CTX_PARAMS bool finished, GameState_t state)
+{
+    if (check_for_request(CTX_ARG)) {
+        ctx->message.turn_pending = true;
+    }
+    if (ctx->message.turn_pending && input_any_event_p(CTX_ARG)) {
+        finished = true;
+    }
 
-#define MESSAGE_DURATION 500
-
-/** Display a character to the display from a void pointer
-    @param character is a pointer to a char object */
-static void display_character(void* character) {
-    char buffer[2];
-    buffer[0] = *(char*)character;
-    buffer[1] = '\0';
-    tinygl_text(buffer);
-}
-
-/** Display a point to the display from a void pointer
-    @param point is a pointer to a tinygl_point_t object */
-static void display_point(void* point) {
-   tinygl_draw_point(*(tinygl_point_t*)point, 1);
+    if (!finished) {
+        return state;
+    }
+    if (ctx->message.turn_pending) {
+        ctx->message.turn_pending = false;
+        return ATTACK;
+    }
+    return WAIT;
 }
 
-
-/** Display something to the screen for a set duration, by calling a passed display_function
- *  and waiting until MESSAGE_DURATION has elapsed.
-    @param item The item to be passed to a provided display_function 
-    @param display_function A pointer to the function to be called for the defined duration
-    @param reset A flag to reset the counter to zero, required when the function is interrupted 
-    @return Whether or not the MESSAGE_DURATION has elapsed*/
-static bool display_from_function(void* item, void (*display_function)(void*), bool reset)
+/** Play the animation for the outcome of a shot, without blocking the other board.
+    @param animation The animation to play
+    @param state The state playing the animation
+    @return The next game state */
+static GameState_t show_outcome(CTX_PARAMS const sprite_animation_t* animation, 
+                                GameState_t state)
 {
-    // Display a character for a predefined MESSAGE_DURATION
-    // TO-DO: Move message-duration to an _init function
-    
-    static uint16_t display_time = 0;
-
-    // Initialise the display if this is the first call
-    if (display_time == 0) {
-        tinygl_clear();
-        display_function(item);
+    GameState_t next_state = outcome_update(CTX_ARGS sprite_animate(CTX_ARGS animation), state);
+    if (next_state != state) {
+        // Stop the animation in case it was skipped part way through
+        sprite_stop(CTX_ARG);
     }
-
-    if (reset) {
-        // The wait function sometimes doesn't finish a full display. This is used to reset the
-        // counter to zero if we never hit MESSAGE_DURATION.
-        display_time = 0; 
-    } else if (display_time < MESSAGE_DURATION) {
-        display_time++;
-        return 0;
-    }
-    
-    // Reset the timer and clear the display
-    display_time = 0;
-    tinygl_clear();
-    return 1;
+    return next_state;
 }
 
+/** Play a splash animation ending in 'M' to inform the user they missed.
+    @return The next game state */
+GameState_t miss(CTX_PARAM) 
+{
+    return show_outcome(CTX_ARGS &SPRITE_MISS, MISS);
+}
 
-/** Display a 'M' to inform the user they missed.
+/** Play an explosion animation ending in 'H' to inform the user they hit.
     @return The next game state */
-GameState_t miss(void) 
+GameState_t hit(CTX_PARAM) 
 {
-    // Display a miss message
-    char c = 'M';
-    if (display_from_function(&c, &display_character, false) == 0) {
-        return MISS;
-    }
-    return WAIT;
+    return show_outcome(CTX_ARGS &SPRITE_HIT, HIT);
 }
 
-/** Display a 'H' to inform the user they hit.
+/** Play a sinking ship animation, followed by the number of the ship that was sunk.
     @return The next game state */
-GameState_t hit(void) 
+GameState_t sunk(CTX_PARAM) 
 {
-    // Display a hit message
-    char c = 'H';
-    if (display_from_function(&c, &display_character, false) == 0) {
-        return HIT;
-    }
-    return WAIT;
+    return show_outcome(CTX_ARGS &SPRITE_SINK[get_sunk_ship(CTX_ARG)], SUNK);
 }
 
-/** Display a 'W' to inform the user they've won the game.
+/** Swap fleets with the other board to check its answers, then flash the result.
+    @param winner Whether this player won the game
     @return The next game state */
-GameState_t win(void) 
+static GameState_t game_over(CTX_PARAMS bool winner)
 {
-    // Display a hit message
-    char c = 'W';
-    if (display_from_function(&c, &display_character, false) == 0) {
-        return WIN;
+    if (!ctx->message.revealed) {
+        ctx->message.verdict = exchange_reveal(CTX_ARGS winner);
+        ctx->message.revealed = true;
+        // Ready for the next game straight away, as the other board's next commitment may
+        // arrive while the result is still showing
+        verify_reset(CTX_ARG);
+    }
+
+    // Keep answering, in case our last acknowledgement of the other boards reveal was lost
+    check_for_request(CTX_ARG);
+
+    const sprite_animation_t* animation = winner ? &SPRITE_WIN : &SPRITE_LOSS;
+    if (ctx->message.verdict == VERIFY_UNVERIFIED) {
+        animation = winner ? &SPRITE_WIN_UNVERIFIED : &SPRITE_LOSS_UNVERIFIED;
+    } else if (ctx->message.verdict == VERIFY_CHEATED) {
+        animation = &SPRITE_CHEAT;
     }
+    if (!sprite_animate(CTX_ARGS animation)) {
+        return winner ? WIN : LOSS;
+    }
+    ctx->message.revealed = false;
     return SETUP;
 }
 
-/** Display a 'L' to inform the user they've lost the game.
+/** Flash a 'W' to inform the user they've won the game, or an 'X' if the other board
+    is found to have cheated. The 'W' alternates with a '?' if its fleet couldn't be checked.
     @return The next game state */
-GameState_t loss(void) 
+GameState_t win(CTX_PARAM) 
 {
-    // Display a hit message
-    char c = 'L';
-    if (display_from_function(&c, &display_character, false) == 0) {
-        return LOSS;
-    }
-    return SETUP;
+    return game_over(CTX_ARGS true);
+}
+
+/** Flash a 'L' to inform the user they've lost the game, or an 'X' if the other board
+    is found to have cheated. The 'L' alternates with a '?' if its fleet couldn't be checked.
+    @return The next game state */
+GameState_t loss(CTX_PARAM) 
+{
+    return game_over(CTX_ARGS false);
 }
 
 
-/** Draw three moving dots (a loading symbol) on the display to inform the user
+/** Draw a moving dot (a loading symbol) on the display to inform the user
     they are waiting for the other player. The next game state is determined by
     whether a hit request has been received.
     @return The next game state */
-GameState_t wait(void) 
+GameState_t wait(CTX_PARAM) 
 {
-   // Display three moving dots on the display
-   static tinygl_point_t point = {2, 2};
-   if (display_from_function(&point, &display_point, false)) {
-        if (point.y == 4) {
-            point.y = 2;
-        } else {
-            point.y++;
-        }
-   };
+    // Display a moving dot on the display, restarting the animation when it finishes,
+    // unless the hidden telemetry view has been opened
+    if (!telemetry_update(CTX_ARG)) {
+        sprite_animate(CTX_ARGS &SPRITE_WAIT);
+    }
 
     // Use the communication module to check for an update, and determine the 
     // gamestate from this.
-    if (check_for_request()) {
-        // On the last display refresh, make sure the timer resets.
-        display_from_function(&point, &display_point, true);
+    if (check_for_request(CTX_ARG)) {
+        // Stop the animation part way through, so it starts fresh next time.
+        sprite_stop(CTX_ARG);
+        telemetry_close(CTX_ARG);
         return ATTACK;
     }
     return WAIT;
@@ -12,44 +12,51 @@
 #include "tinygl.h"
 #include "gamestate.h"
 #include "communication.h"
+#include "context.h"
+
+/* State of the messages, part of game_context_t. turn_pending is set when the other board
+   fires while the outcome of our own shot is still being shown. */
+typedef struct {
+    bool revealed;
+    VerifyResult_t verdict;
+    bool turn_pending;
+} message_context_t;
+
+#define MESSAGE_CONTEXT_INIT {.verdict = VERIFY_HONEST}
+
+/** Answer the other board while the outcome of our last shot is shown, so their next shot
+    isn't held up until it finishes. If they have already fired, it's our turn again, and
+    any navswitch event skips the rest of the outcome.
+    @param finished Whether the outcome has been shown in full
+    @param state The state showing the outcome
+    @return The next game state */
+GameState_t outcome_update(CTX_PARAMS bool finished, GameState_t state);
+
+/** Play a splash animation ending in 'M' to inform the user they missed.
+    @return The next game state */
+GameState_t miss(CTX_PARAM);
 
-/** Display a 'M' to inform the user they missed.
+/** Play an explosion animation ending in 'H' to inform the user they hit.
     @return The next game state */
-GameState_t miss(void);
+GameState_t hit(CTX_PARAM);
 
-/** Display a 'H' to inform the user they hit.
+/** Play a sinking ship animation, followed by the number of the ship that was sunk.
     @return The next game state */
-GameState_t hit(void);
+GameState_t sunk(CTX_PARAM);
 
-/** Display a 'W' to inform the user they've won the game. */
-GameState_t win(void);
+/** Flash a 'W' to inform the user they've won the game, or an 'X' if the other board
+    is found to have cheated. The 'W' alternates with a '?' if its fleet couldn't be checked. */
+GameState_t win(CTX_PARAM);
 
-/** Display a 'L' to inform the user they've lost the game. */
-GameState_t loss(void);
+/** Flash a 'L' to inform the user they've lost the game, or an 'X' if the other board
+    is found to have cheated. The 'L' alternates with a '?' if its fleet couldn't be checked. */
+GameState_t loss(CTX_PARAM);
 
-/** Draw three moving dots (a loading symbol) on the display to inform the user
+/** Draw a moving dot (a loading symbol) on the display to inform the user
     they are waiting for the other player. The next game state is determined by
     whether a hit request has been received.
     @return The next game state */
-GameState_t wait(void);
-
-
-// Private functions
-
-/** Display a character to the display from a void pointer
-    @param character is a pointer to a char object */
-void display_character(void* character);
-
-/** Display a point to the display from a void pointer
-    @param point is a pointer to a tinygl_point_t object */
-void display_point(void* point);
+GameState_t wait(CTX_PARAM);
 
-/** Display something to the screen for a set duration, by calling a passed display_function
- *  and waiting until MESSAGE_DURATION has elapsed.
-    @param item The item to be passed to a provided display_function 
-    @param display_function A pointer to the function to be called for the defined duration
-    @param reset A flag to reset the counter to zero, required when the function is interrupted 
-    @return Whether or not the MESSAGE_DURATION has elapsed*/
-bool display_from_function(void* item, void (*display_function)(void*), bool reset);
 
 #endif // MESSAGE_H
\ No newline at end of file
@@ -0,0 +1,47 @@
+/**
+  @file random.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Pseudo-random numbers, seeded from timer jitter and the timing of navswitch presses.
+ */
+
+#include "system.h"
+#include "random.h"
+#include "game_context.h"
+
+/** Mix a sample of unpredictable timing into the generator state.
+    @param sample The timing sample */
+void random_add_entropy(CTX_PARAMS uint16_t sample)
+{
+    ctx->random.state = ROTL(ctx->random.state, 7) ^ sample;
+    if (ctx->random.state == 0) {
+        ctx->random.state = RANDOM_DEFAULT_STATE;
+    }
+}
+
+
+/** Get the next pseudo-random number.
+    @return 32 random bits */
+uint32_t random_next(CTX_PARAM)
+{
+    // xorshift32
+    ctx->random.state ^= ctx->random.state << 13;
+    ctx->random.state ^= ctx->random.state >> 17;
+    ctx->random.state ^= ctx->random.state << 5;
+    return ctx->random.state;
+}
+
+
+/** Get a uniformly distributed random number in a range, without modulo bias.
+    @param bound The upper limit of the range, which must be greater than zero
+    @return A random number from 0 to bound - 1 */
+uint8_t random_below(CTX_PARAMS uint8_t bound)
+{
+    // Reject the top partial range of bytes so every result is equally likely
+    uint8_t limit = 256 - (256 % bound);
+    uint8_t value;
+    do {
+        value = random_next(CTX_ARG);
+    } while (limit != 0 && value >= limit);
+    return value % bound;
+}
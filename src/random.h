@@ -0,0 +1,39 @@
+/**
+  @file random.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Pseudo-random numbers, seeded from timer jitter and the timing of navswitch presses.
+ */
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include "system.h"
+#include "context.h"
+
+// Rotate a 32 bit value left by b bits, for the generator and the fleet hash
+#define ROTL(x, b) (uint32_t)(((x) << (b)) | ((x) >> (32 - (b))))
+
+#define RANDOM_DEFAULT_STATE 0x2545F491 // Any non-zero value, xorshift gets stuck on zero
+
+/* Generator state, part of game_context_t */
+typedef struct {
+    uint32_t state;
+} random_context_t;
+
+#define RANDOM_CONTEXT_INIT {.state = RANDOM_DEFAULT_STATE}
+
+/** Mix a sample of unpredictable timing into the generator state.
+    @param sample The timing sample */
+void random_add_entropy(CTX_PARAMS uint16_t sample);
+
+/** Get the next pseudo-random number.
+    @return 32 random bits */
+uint32_t random_next(CTX_PARAM);
+
+/** Get a uniformly distributed random number in a range, without modulo bias.
+    @param bound The upper limit of the range, which must be greater than zero
+    @return A random number from 0 to bound - 1 */
+uint8_t random_below(CTX_PARAMS uint8_t bound);
+
+#endif // RANDOM_H
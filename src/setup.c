@@ -12,61 +12,86 @@
 #include "tinygl.h"
 #include "gamestate.h"
 #include "communication.h"
+#include "shade.h"
+#include "input.h"
+#include "verify.h"
+#include "random.h"
+#include "wheel.h"
+#include "game_context.h"
 
-#define NUM_BOATS 8
 #define FLASH_RATE 200 
 #define NORTH_BARRIER 0
 #define WEST_BARRIER 0
 #define EAST_BARRIER 4
+#define PLACED_SHADE SHADE_DIM
+#define PLACING_SHADE SHADE_FULL
+#define PLACING_FLASH_SHADE SHADE_MEDIUM
 
-// standard variables for storing previous and current boats
-static tinygl_point_t boatStart[3];
-static tinygl_point_t boatEnd[3];
-static tinygl_point_t pos1 = {0,0};
-static tinygl_point_t pos2 = {0,2};
-static tinygl_point_t boat_locations[NUM_BOATS] = {{0,0}};
-static uint8_t number_of_boats = 0;
-static uint8_t boat_length = 3;
-static bool length_changed = false;
-
-void reset_boats(void) 
+static const uint8_t ship_lengths[NUM_SHIPS] = FLEET_SHIP_LENGTHS;
+
+void reset_boats(CTX_PARAM) 
 {
-    pos1.x = 0;
-    pos1.y = 0;
-    pos2.x = 0;
-    pos2.y = 2;
-    length_changed = false;
-    number_of_boats = 0;
-    boat_length = 3;
+    ctx->setup.pos1.x = 0;
+    ctx->setup.pos1.y = 0;
+    ctx->setup.pos2.x = 0;
+    ctx->setup.pos2.y = 2;
+    ctx->setup.length_changed = false;
+    ctx->setup.number_of_boats = 0;
+    ctx->setup.boat_length = 3;
+    ctx->setup.suggested = false;
 }
 
 /* For each boat already placed, display it on the screen every cycle
    of the paced loop.
  */
-void boat_update(void) 
+void boat_update(CTX_PARAM) 
 {
     // Display all stored placed boats.
-    for (uint8_t i = 0; i < number_of_boats; i++) {
-        tinygl_draw_line(boatStart[i], boatEnd[i], 1);
+    for (uint8_t i = 0; i < ctx->setup.number_of_boats; i++) {
+        shade_draw_line(CTX_ARGS ctx->setup.boatStart[i], ctx->setup.boatEnd[i], PLACED_SHADE);
+    }
+
+    // And the rest of an auto-placed fleet, after the boat being placed
+    for (uint8_t i = ctx->setup.number_of_boats + 1; ctx->setup.suggested && i < NUM_SHIPS; i++) {
+        tinygl_point_t end = {ctx->setup.suggestion[i].x, 
+                              ctx->setup.suggestion[i].y + ship_lengths[i] - 1};
+        shade_draw_line(CTX_ARGS ctx->setup.suggestion[i], end, PLACED_SHADE);
     }
 }
 
 
-/** Uses a division of the paced loop to flash the boat 
+/** Make a boat of the auto-placed fleet the boat being placed, where it was generated.
+    @param boat Index of the boat */
+static void offer_boat(CTX_PARAMS uint8_t boat)
+{
+    ctx->setup.pos1 = ctx->setup.suggestion[boat];
+    ctx->setup.pos2.x = ctx->setup.pos1.x;
+    ctx->setup.pos2.y = ctx->setup.pos1.y + ship_lengths[boat] - 1;
+    ctx->setup.boat_length = ship_lengths[boat];
+    // get_boat_length shortens the last boat when it's reached, but this is already its length
+    ctx->setup.length_changed = (boat == NUM_SHIPS - 1);
+    shade_clear(CTX_ARG);
+}
+
+
+/** Toggle the boat being placed, each time the boat flash timer expires.
+    @param timer The expired timer */
+static void toggle_boat(CTX_PARAMS uint8_t timer)
+{
+    (void)timer;
+    ctx->setup.flash_state = !ctx->setup.flash_state;
+}
+
+
+/** Flash the boat with a periodic timer, started on the first call
     @return on/off led flash
  */
-bool flash_boat(void) 
+bool flash_boat(CTX_PARAM) 
 {
-    // Keep track of elapsed time in order to flash the cursor
-    static uint16_t flash = 0;
-    static bool state = 1;
-    flash++;
-
-    if (flash >= FLASH_RATE) { // Need to remove magic numbers
-        state = !state;
-        flash = 0;
+    if (!wheel_timer_running_p(CTX_ARGS WHEEL_TIMER_BOAT_FLASH)) {
+        wheel_timer_start(CTX_ARGS WHEEL_TIMER_BOAT_FLASH, FLASH_RATE, FLASH_RATE, toggle_boat);
     }
-    return state;
+    return ctx->setup.flash_state;
 }
 
 
@@ -75,20 +100,20 @@ bool flash_boat(void)
     placed boat. 
     @returns returns 0 if overlap, 1 if not
  */
-bool boat_already_placed(void)
+bool boat_already_placed(CTX_PARAM)
 {
     // iterates over every placed boat
-    for (uint8_t i = 0; i < number_of_boats; i++) {
+    for (uint8_t i = 0; i < ctx->setup.number_of_boats; i++) {
         
         //changes type tinygl to algebra for comparrisons 
-        uint8_t check_x = pos1.x ;
-        uint8_t compare_x = boatStart[i].x;
-        uint8_t check_y = pos1.y;
-        uint8_t compare_y = boatStart[i].y;
+        uint8_t check_x = ctx->setup.pos1.x ;
+        uint8_t compare_x = ctx->setup.boatStart[i].x;
+        uint8_t check_y = ctx->setup.pos1.y;
+        uint8_t compare_y = ctx->setup.boatStart[i].y;
 
         
         // uses if statement comparisson to compare every bit
-        if (boat_length == 3) {
+        if (ctx->setup.boat_length == 3) {
             if (((check_y == compare_y) || 
                 (check_y == (compare_y+1)) || 
                 (check_y == (compare_y+2)) || 
@@ -101,7 +126,7 @@ bool boat_already_placed(void)
                 (check_x == compare_x)) {
                     return false; // returns false if there is overlap
                 }    
-        } else if (boat_length == 2) {
+        } else if (ctx->setup.boat_length == 2) {
             if (((check_y == compare_y) || 
                 (check_y == (compare_y+1)) || 
                 (check_y == (compare_y+2)) || 
@@ -118,29 +143,34 @@ bool boat_already_placed(void)
 }
 
 
-/** Sets current location to placed boat */
-void boat_place(void)
+/** Sets current location to placed boat. This waits for the push to be released, so a
+    long push that auto-places the fleet doesn't place a boat first.
+ */
+void boat_place(CTX_PARAM)
 {
-    if (navswitch_push_event_p (NAVSWITCH_PUSH)) {
-        if(boat_already_placed()) {
-            boatStart[number_of_boats] = pos1;
-            boatEnd[number_of_boats] = pos2;
-            number_of_boats += 1;
+    if (input_short_push_p(CTX_ARG)) {
+        if(boat_already_placed(CTX_ARG)) {
+            ctx->setup.boatStart[ctx->setup.number_of_boats] = ctx->setup.pos1;
+            ctx->setup.boatEnd[ctx->setup.number_of_boats] = ctx->setup.pos2;
+            ctx->setup.number_of_boats += 1;
+            if (ctx->setup.suggested && ctx->setup.number_of_boats < NUM_SHIPS) {
+                offer_boat(CTX_ARGS ctx->setup.number_of_boats);
+            }
         }
     }
 }
 
 
 /**changes the length of the boat after two boats are placed */
-void get_boat_length(void)
+void get_boat_length(CTX_PARAM)
 {
-    if ((number_of_boats == 2) && (length_changed == false)) {
-        boat_length = 2;
+    if ((ctx->setup.number_of_boats == 2) && (ctx->setup.length_changed == false)) {
+        ctx->setup.boat_length = 2;
     }
-    if ((boat_length == 2) && (length_changed == false)) {
-        tinygl_clear();
-        pos2.y -= 1;
-        length_changed = true;
+    if ((ctx->setup.boat_length == 2) && (ctx->setup.length_changed == false)) {
+        shade_clear(CTX_ARG);
+        ctx->setup.pos2.y -= 1;
+        ctx->setup.length_changed = true;
     }
 }
 
@@ -149,77 +179,113 @@ void get_boat_length(void)
     of current boat
     @return The next state of the game
  */
-GameState_t select_boat_position(void)
+GameState_t select_boat_position(CTX_PARAM)
 {
-    uint8_t south_barrier = 6-boat_length+1;
-    get_boat_length();
+    uint8_t south_barrier = 6-ctx->setup.boat_length+1;
+    get_boat_length(CTX_ARG);
     
     //moves both ends of current boat using nav switch
-    if (navswitch_push_event_p (NAVSWITCH_SOUTH)) {
-        if (pos1.y < (south_barrier)) {
-            tinygl_clear();
-            pos1.y += 1; 
-            pos2.y += 1; 
+    if (input_event_p(CTX_ARGS NAVSWITCH_SOUTH)) {
+        if (ctx->setup.pos1.y < (south_barrier)) {
+            shade_clear(CTX_ARG);
+            ctx->setup.pos1.y += 1; 
+            ctx->setup.pos2.y += 1; 
         }
     }
-    if (navswitch_push_event_p (NAVSWITCH_EAST)) {
-        if (pos1.x < EAST_BARRIER) {
-            tinygl_clear();
-            pos1.x += 1; 
-            pos2.x += 1;
+    if (input_event_p(CTX_ARGS NAVSWITCH_EAST)) {
+        if (ctx->setup.pos1.x < EAST_BARRIER) {
+            shade_clear(CTX_ARG);
+            ctx->setup.pos1.x += 1; 
+            ctx->setup.pos2.x += 1;
         }
     }
-    if (navswitch_push_event_p (NAVSWITCH_NORTH)) {
-        if (pos1.y > NORTH_BARRIER) {
-            tinygl_clear();
-            pos1.y -= 1;
-            pos2.y -= 1;
+    if (input_event_p(CTX_ARGS NAVSWITCH_NORTH)) {
+        if (ctx->setup.pos1.y > NORTH_BARRIER) {
+            shade_clear(CTX_ARG);
+            ctx->setup.pos1.y -= 1;
+            ctx->setup.pos2.y -= 1;
         }
     }
-    if (navswitch_push_event_p (NAVSWITCH_WEST)) {
+    if (input_event_p(CTX_ARGS NAVSWITCH_WEST)) {
         
-        if (pos1.x > WEST_BARRIER) {
-            tinygl_clear();
-            pos1.x -= 1; 
-            pos2.x -= 1; 
+        if (ctx->setup.pos1.x > WEST_BARRIER) {
+            shade_clear(CTX_ARG);
+            ctx->setup.pos1.x -= 1; 
+            ctx->setup.pos2.x -= 1; 
         }
     }
-    tinygl_draw_line(pos1, pos2, flash_boat());
+    shade_draw_line(CTX_ARGS ctx->setup.pos1, ctx->setup.pos2, 
+                    flash_boat(CTX_ARG) ? PLACING_SHADE : PLACING_FLASH_SHADE);
 
-    boat_place();
+    boat_place(CTX_ARG);
    return SETUP;
 }
 
 
-/** stores the position of each LED of boat as its own tingl_point
-    treated as individual boats
+/** Passes the placed boats to the communication module, which
+    maps each cell of the board to the boat covering it
  */
-void boat_save(void)
+void boat_save(CTX_PARAM)
 {
-    //stores boats as array
-    uint8_t write_index = 0;
-    for (uint8_t i = 0; i < number_of_boats; i++) {
-        for (uint8_t pos = boatStart[i].y; pos <= boatEnd[i].y; pos++) {
-            boat_locations[write_index].y = pos;
-            boat_locations[write_index].x = boatStart[i].x;
-            write_index++;
+    store_own_boats(CTX_ARGS ctx->setup.boatStart, ctx->setup.boatEnd, ctx->setup.number_of_boats);
+    verify_commit_fleet(CTX_ARGS ctx->setup.boatStart, ctx->setup.number_of_boats);
+}
+
+
+/** Replaces any boats placed so far with a uniformly random legal fleet.
+    None of it is placed yet. Each boat in turn becomes the boat being 
+    placed, starting where it was generated, so the player can still move
+    any of them before pushing. Rejection sampling keeps every legal fleet equally likely. About a
+    third of attempts overlap and are rejected, so it takes about one
+    and a half attempts on average, which fits in a tick.
+ */
+void auto_place(CTX_PARAM)
+{
+    tinygl_point_t* starts = ctx->setup.suggestion;
+    uint8_t occupied[NUM_COLS];
+    bool legal;
+
+    do {
+        legal = true;
+        for (uint8_t x = 0; x < NUM_COLS; x++) {
+            occupied[x] = 0;
         }
-    }
-    store_own_boats(boat_locations);
+
+        for (uint8_t i = 0; i < NUM_SHIPS; i++) {
+            starts[i].x = random_below(CTX_ARGS NUM_COLS);
+            starts[i].y = random_below(CTX_ARGS NUM_OF_ROWS - ship_lengths[i] + 1);
+
+            // One bit per row of the column the boat is in
+            uint8_t cells = ((1 << ship_lengths[i]) - 1) << starts[i].y;
+            if (occupied[starts[i].x] & cells) {
+                legal = false;
+            }
+            occupied[starts[i].x] |= cells;
+        }
+    } while (!legal);
+
+    ctx->setup.suggested = true;
+    ctx->setup.number_of_boats = 0;
+    offer_boat(CTX_ARGS 0);
 }
 
 
 /** Main function to run setup state
  *  @return The next state of the game
 */
-GameState_t set(void)
+GameState_t set(CTX_PARAM)
 {
-    select_boat_position();
-    boat_update();
-    if (number_of_boats == 3) {
-        boat_save();
-        return send_init();
+    // Holding the push button down throws the whole fleet onto the board at random
+    if (input_long_push_p(CTX_ARG)) {
+        auto_place(CTX_ARG);
+    }
+    select_boat_position(CTX_ARG);
+    boat_update(CTX_ARG);
+    if (ctx->setup.number_of_boats == NUM_SHIPS) {
+        boat_save(CTX_ARG);
+        wheel_timer_stop(CTX_ARGS WHEEL_TIMER_BOAT_FLASH);
+        return send_init(CTX_ARG);
     }
-    check_for_request();
+    check_for_request(CTX_ARG);
     return SETUP;
 }
\ No newline at end of file
@@ -14,19 +14,36 @@
 #include "tinygl.h"
 #include "gamestate.h"
 #include "communication.h"
-
-void reset_boats(void);
+#include "context.h"
+
+/* State of the setup phase, part of game_context_t */
+typedef struct {
+    tinygl_point_t boatStart[NUM_SHIPS];
+    tinygl_point_t boatEnd[NUM_SHIPS];
+    tinygl_point_t pos1;
+    tinygl_point_t pos2;
+    uint8_t number_of_boats;
+    uint8_t boat_length;
+    bool length_changed;
+    bool flash_state;
+    tinygl_point_t suggestion[NUM_SHIPS]; // First cell of each boat of the fleet from auto_place
+    bool suggested; // Each boat is offered at its place in suggestion until it's placed
+} setup_context_t;
+
+#define SETUP_CONTEXT_INIT {.pos2 = {0, 2}, .boat_length = 3, .flash_state = 1}
+
+void reset_boats(CTX_PARAM);
 
 /* For each boat already placed, display it on the screen every cycle
    of the paced loop.
  */
-void boat_update(void);
+void boat_update(CTX_PARAM);
 
 
-/** Uses a division of the paced loop to flash the boat 
+/** Flash the boat with a periodic timer, started on the first call
     @return on/off led flash
  */
-bool flash_boat(void);
+bool flash_boat(CTX_PARAM);
 
 
 /** Checks wether the current location of the 
@@ -34,30 +51,40 @@ bool flash_boat(void);
     placed boat. 
     @returns returns 0 if overlap, 1 if not
  */
-bool boat_already_placed(void);
+bool boat_already_placed(CTX_PARAM);
 
-/** Sets current location to placed boat */
-void boat_place(void);
+/** Sets current location to placed boat. This waits for the push to be released, so a
+    long push that auto-places the fleet doesn't place a boat first.
+ */
+void boat_place(CTX_PARAM);
 
 /**Changes the length of the boat after two boats are placed */
-void get_boat_length(void);
+void get_boat_length(CTX_PARAM);
 
 
 /** Reads navigation input and updates location
     of current boat
     @return The next state of the game
  */
-GameState_t select_boat_position(void);
+GameState_t select_boat_position(CTX_PARAM);
+
+/** Passes the placed boats to the communication module, which
+    maps each cell of the board to the boat covering it
+ */
+void boat_save(CTX_PARAM);
+
 
-/** stores the position of each LED of boat as its own tingl_point
-    treated as individual boats
+/** Replaces any boats placed so far with a uniformly random legal fleet.
+    None of it is placed yet. Each boat in turn becomes the boat being 
+    placed, starting where it was generated, so the player can still move
+    any of them before pushing.
  */
-void boat_save(void);
+void auto_place(CTX_PARAM);
 
 
 /** Main function to run setup state
  *  @return The next state of the game
 */
-GameState_t set(void);
+GameState_t set(CTX_PARAM);
 
 #endif
\ No newline at end of file
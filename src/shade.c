@@ -0,0 +1,123 @@
+/**
+  @file shade.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Multi-level LED intensity rendering on top of tinygl, using bit-angle modulation.
+ */
+
+#include "system.h"
+#include "tinygl.h"
+#include "pacer.h"
+#include "shade.h"
+#include "game_context.h"
+
+/* tinygl_update scans one column per call, so a full display frame takes TINYGL_WIDTH scans.
+   Each column shows one bit plane per scan, and plane n for 2^n of every CYCLE_FRAMES scans
+   of that column. Columns are offset in the cycle so the planes are interleaved across the
+   display. At SHADE_SCANS_PER_TICK scans per 2ms tick, a column is scanned every 3.3ms and
+   the modulation cycle of each pixel is 10ms, i.e. 100Hz. */
+#define CYCLE_FRAMES ((1 << SHADE_BITS) - 1)
+
+/** Set every pixel to SHADE_OFF */
+void shade_clear(CTX_PARAM)
+{
+    for (uint8_t plane = 0; plane < SHADE_BITS; plane++) {
+        for (uint8_t col = 0; col < TINYGL_WIDTH; col++) {
+            ctx->shade.planes[plane][col] = 0;
+        }
+    }
+}
+
+
+/** Set the brightness of a single pixel. Points off the display are ignored.
+    @param point The pixel to set
+    @param level The brightness of the pixel */
+void shade_draw_point(CTX_PARAMS tinygl_point_t point, shade_level_t level)
+{
+    if (point.x < 0 || point.x >= TINYGL_WIDTH || point.y < 0 || point.y >= TINYGL_HEIGHT) {
+        return;
+    }
+
+    for (uint8_t plane = 0; plane < SHADE_BITS; plane++) {
+        if (level & (1 << plane)) {
+            ctx->shade.planes[plane][point.x] |= (1 << point.y);
+        } else {
+            ctx->shade.planes[plane][point.x] &= ~(1 << point.y);
+        }
+    }
+}
+
+
+/** Draw a horizontal, vertical or diagonal line, including both end points.
+    @param start First end of the line
+    @param end Second end of the line
+    @param level The brightness of the line */
+void shade_draw_line(CTX_PARAMS tinygl_point_t start, tinygl_point_t end, shade_level_t level)
+{
+    int8_t dx = (end.x > start.x) - (end.x < start.x);
+    int8_t dy = (end.y > start.y) - (end.y < start.y);
+
+    shade_draw_point(CTX_ARGS start, level);
+    while (start.x != end.x || start.y != end.y) {
+        start.x += dx;
+        start.y += dy;
+        shade_draw_point(CTX_ARGS start, level);
+    }
+}
+
+
+/** Work out which bit plane a column shows in a given frame of the modulation cycle.
+    Plane n is shown for 2^n consecutive frames.
+    @param cycle_frame The frame within the modulation cycle
+    @return The bit plane to display */
+static uint8_t plane_for_frame(uint8_t cycle_frame)
+{
+    uint8_t plane = 0;
+    while (cycle_frame >= (1 << plane)) {
+        cycle_frame -= (1 << plane);
+        plane++;
+    }
+    return plane;
+}
+
+
+/** Load the next column into tinygl with the bit plane due for it, and scan it.
+    @return Whether this scan started a new display frame */
+static bool shade_scan(CTX_PARAM)
+{
+    uint8_t col = ctx->shade.column;
+    uint8_t plane = plane_for_frame((ctx->shade.frame + col) % CYCLE_FRAMES);
+    uint8_t column = ctx->shade.planes[plane][col];
+
+    for (uint8_t row = 0; row < TINYGL_HEIGHT; row++) {
+        tinygl_point_t point = {col, row};
+        tinygl_pixel_set(point, (column >> row) & 1);
+    }
+    tinygl_update();
+
+    ctx->shade.column++;
+    if (ctx->shade.column >= TINYGL_WIDTH) {
+        ctx->shade.column = 0;
+        ctx->shade.frame++;
+        if (ctx->shade.frame >= CYCLE_FRAMES) {
+            ctx->shade.frame = 0;
+        }
+    }
+    return col == 0;
+}
+
+
+/** Wait for the next tick of the game loop, scanning the display SHADE_SCANS_PER_TICK
+ *  times while waiting. This takes the place of pacer_wait, and also keeps the display
+ *  lit while blocked on the other board.
+    @return Whether a new display frame was started this tick */
+bool shade_tick(CTX_PARAM)
+{
+    bool frame_started = false;
+
+    for (uint8_t i = 0; i < SHADE_SCANS_PER_TICK; i++) {
+        pacer_wait();
+        frame_started |= shade_scan(CTX_ARG);
+    }
+    return frame_started;
+}
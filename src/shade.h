@@ -0,0 +1,60 @@
+/**
+  @file shade.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Multi-level LED intensity rendering on top of tinygl, using bit-angle modulation.
+ */
+
+#ifndef SHADE_H
+#define SHADE_H
+
+#include "system.h"
+#include "tinygl.h"
+
+#include "context.h"
+
+#define SHADE_BITS 2
+
+// The display is scanned this many times per tick of the game loop, so the pacer must run
+// this many times faster than the game
+#define SHADE_SCANS_PER_TICK 3
+
+/* Display state, part of game_context_t. There is one byte per display column for each 
+   bit plane, bit 0 being the top row. */
+typedef struct {
+    uint8_t planes[SHADE_BITS][TINYGL_WIDTH];
+    uint8_t column;
+    uint8_t frame;
+} shade_context_t;
+
+/* Brightness of a pixel. Each bit of the level is a bit plane, and plane n is shown
+   for 2^n display frames of every modulation cycle. */
+typedef enum {
+    SHADE_OFF = 0,
+    SHADE_DIM,
+    SHADE_MEDIUM,
+    SHADE_FULL
+} shade_level_t;
+
+
+/** Set every pixel to SHADE_OFF */
+void shade_clear(CTX_PARAM);
+
+/** Set the brightness of a single pixel. Points off the display are ignored.
+    @param point The pixel to set
+    @param level The brightness of the pixel */
+void shade_draw_point(CTX_PARAMS tinygl_point_t point, shade_level_t level);
+
+/** Draw a horizontal, vertical or diagonal line, including both end points.
+    @param start First end of the line
+    @param end Second end of the line
+    @param level The brightness of the line */
+void shade_draw_line(CTX_PARAMS tinygl_point_t start, tinygl_point_t end, shade_level_t level);
+
+/** Wait for the next tick of the game loop, scanning the display SHADE_SCANS_PER_TICK
+ *  times while waiting. This takes the place of pacer_wait, and also keeps the display
+ *  lit while blocked on the other board.
+    @return Whether a new display frame was started this tick */
+bool shade_tick(CTX_PARAM);
+
+#endif // SHADE_H
@@ -0,0 +1,187 @@
+/**
+  @file sprite.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Precomputed sprite animations for status messages. Frames are stored as column 
+         bitmaps in program memory and copied to the display only when the frame changes.
+ */
+
+#include <avr/pgmspace.h>
+#include "system.h"
+#include "tinygl.h"
+#include "sprite.h"
+#include "shade.h"
+#include "wheel.h"
+#include "game_context.h"
+
+#define FRAME_DURATION 100
+#define WAIT_FRAME_DURATION 500
+
+// Frames are precomputed column bitmaps, bit 0 being the top row of the display.
+static const sprite_frame_t hit_frames[] PROGMEM = {
+    {{0x00, 0x00, 0x08, 0x00, 0x00}}, // Spark
+    {{0x00, 0x08, 0x1C, 0x08, 0x00}}, // Burst
+    {{0x08, 0x14, 0x22, 0x14, 0x08}}, // Shockwave
+    {{0x7F, 0x08, 0x08, 0x08, 0x7F}}, // 'H'
+    {{0x7F, 0x08, 0x08, 0x08, 0x7F}}
+};
+
+static const sprite_frame_t miss_frames[] PROGMEM = {
+    {{0x00, 0x00, 0x08, 0x00, 0x00}}, // Splash
+    {{0x00, 0x08, 0x14, 0x08, 0x00}}, // Ripple
+    {{0x08, 0x14, 0x22, 0x14, 0x08}}, // Wider ripple
+    {{0x7F, 0x02, 0x0C, 0x02, 0x7F}}, // 'M'
+    {{0x7F, 0x02, 0x0C, 0x02, 0x7F}}
+};
+
+#define SINK_NUM_FRAMES 7
+
+// A sinking ship followed by an 'S' and the number of the ship, from 1
+#define SINK_FRAMES(...) {                                                     \
+    {{0x08, 0x08, 0x08, 0x08, 0x08}}, /* Hull on the surface */                \
+    {{0x10, 0x10, 0x10, 0x10, 0x10}}, /* Going down */                         \
+    {{0x20, 0x20, 0x20, 0x20, 0x20}},                                          \
+    {{0x40, 0x40, 0x40, 0x40, 0x40}}, /* On the bottom */                      \
+    {{0x46, 0x49, 0x49, 0x49, 0x31}}, /* 'S' */                                \
+    {{__VA_ARGS__}},                                                           \
+    {{__VA_ARGS__}}                                                            \
+}
+
+static const sprite_frame_t sink_frames[SPRITE_NUM_SINK][SINK_NUM_FRAMES] PROGMEM = {
+    SINK_FRAMES(0x00, 0x42, 0x7F, 0x40, 0x00), // '1'
+    SINK_FRAMES(0x42, 0x61, 0x51, 0x49, 0x46), // '2'
+    SINK_FRAMES(0x21, 0x41, 0x45, 0x4B, 0x31)  // '3'
+};
+
+static const sprite_frame_t win_frames[] PROGMEM = {
+    {{0x3F, 0x40, 0x38, 0x40, 0x3F}}, // 'W'
+    {{0x7F, 0x41, 0x41, 0x41, 0x7F}}, // Border
+    {{0x3F, 0x40, 0x38, 0x40, 0x3F}},
+    {{0x7F, 0x41, 0x41, 0x41, 0x7F}},
+    {{0x3F, 0x40, 0x38, 0x40, 0x3F}}
+};
+
+static const sprite_frame_t loss_frames[] PROGMEM = {
+    {{0x7F, 0x40, 0x40, 0x40, 0x40}}, // 'L'
+    {{0x00, 0x00, 0x00, 0x00, 0x00}},
+    {{0x7F, 0x40, 0x40, 0x40, 0x40}},
+    {{0x00, 0x00, 0x00, 0x00, 0x00}},
+    {{0x7F, 0x40, 0x40, 0x40, 0x40}}
+};
+
+static const sprite_frame_t cheat_frames[] PROGMEM = {
+    {{0x63, 0x14, 0x08, 0x14, 0x63}}, // 'X'
+    {{0x00, 0x00, 0x00, 0x00, 0x00}},
+    {{0x63, 0x14, 0x08, 0x14, 0x63}},
+    {{0x00, 0x00, 0x00, 0x00, 0x00}},
+    {{0x63, 0x14, 0x08, 0x14, 0x63}}
+};
+
+static const sprite_frame_t win_unverified_frames[] PROGMEM = {
+    {{0x3F, 0x40, 0x38, 0x40, 0x3F}}, // 'W'
+    {{0x02, 0x01, 0x51, 0x09, 0x06}}, // '?'
+    {{0x3F, 0x40, 0x38, 0x40, 0x3F}},
+    {{0x02, 0x01, 0x51, 0x09, 0x06}},
+    {{0x3F, 0x40, 0x38, 0x40, 0x3F}}
+};
+
+static const sprite_frame_t loss_unverified_frames[] PROGMEM = {
+    {{0x7F, 0x40, 0x40, 0x40, 0x40}}, // 'L'
+    {{0x02, 0x01, 0x51, 0x09, 0x06}}, // '?'
+    {{0x7F, 0x40, 0x40, 0x40, 0x40}},
+    {{0x02, 0x01, 0x51, 0x09, 0x06}},
+    {{0x7F, 0x40, 0x40, 0x40, 0x40}}
+};
+
+static const sprite_frame_t wait_frames[] PROGMEM = {
+    {{0x00, 0x00, 0x04, 0x00, 0x00}}, // Moving dot
+    {{0x00, 0x00, 0x08, 0x00, 0x00}},
+    {{0x00, 0x00, 0x10, 0x00, 0x00}}
+};
+
+
+#define FRAME_COUNT(frames) (sizeof(frames) / sizeof(frames[0]))
+
+const sprite_animation_t SPRITE_HIT = {hit_frames, FRAME_COUNT(hit_frames), FRAME_DURATION};
+const sprite_animation_t SPRITE_MISS = {miss_frames, FRAME_COUNT(miss_frames), FRAME_DURATION};
+const sprite_animation_t SPRITE_SINK[SPRITE_NUM_SINK] = {
+    {sink_frames[0], FRAME_COUNT(sink_frames[0]), FRAME_DURATION},
+    {sink_frames[1], FRAME_COUNT(sink_frames[1]), FRAME_DURATION},
+    {sink_frames[2], FRAME_COUNT(sink_frames[2]), FRAME_DURATION}
+};
+const sprite_animation_t SPRITE_WIN = {win_frames, FRAME_COUNT(win_frames), FRAME_DURATION};
+const sprite_animation_t SPRITE_LOSS = {loss_frames, FRAME_COUNT(loss_frames), FRAME_DURATION};
+const sprite_animation_t SPRITE_CHEAT = {cheat_frames, FRAME_COUNT(cheat_frames), FRAME_DURATION};
+const sprite_animation_t SPRITE_WIN_UNVERIFIED = {win_unverified_frames, 
+                                                  FRAME_COUNT(win_unverified_frames), 
+                                                  FRAME_DURATION};
+const sprite_animation_t SPRITE_LOSS_UNVERIFIED = {loss_unverified_frames, 
+                                                   FRAME_COUNT(loss_unverified_frames), 
+                                                   FRAME_DURATION};
+const sprite_animation_t SPRITE_WAIT = {wait_frames, FRAME_COUNT(wait_frames), 
+                                        WAIT_FRAME_DURATION};
+
+/** Copy a frame from program memory into the display buffer.
+    @param frame Pointer to the frame in program memory */
+static void sprite_blit(CTX_PARAMS const sprite_frame_t* frame)
+{
+    for (uint8_t col = 0; col < SPRITE_COLS; col++) {
+        uint8_t column = pgm_read_byte(&frame->columns[col]);
+        for (uint8_t row = 0; row < SPRITE_ROWS; row++) {
+            tinygl_point_t point = {col, row};
+            shade_draw_point(CTX_ARGS point, ((column >> row) & 1) ? SHADE_FULL : SHADE_OFF);
+        }
+    }
+}
+
+
+/** Show the next frame of the current animation, each time the frame timer expires. The
+ *  timer is stopped once the final frame has been shown for its time.
+    @param timer The expired timer */
+static void sprite_next_frame(CTX_PARAMS uint8_t timer)
+{
+    const sprite_animation_t* animation = ctx->sprite.current_animation;
+
+    ctx->sprite.current_frame++;
+    if (ctx->sprite.current_frame < animation->num_frames) {
+        sprite_blit(CTX_ARGS &animation->frames[ctx->sprite.current_frame]);
+    } else {
+        wheel_timer_stop(CTX_ARGS timer);
+    }
+}
+
+
+/** Play an animation, one tick per call. The animation is started if it isn't already
+ *  the one playing, and the display is only written when the frame changes.
+    @param animation The animation to play
+    @return Whether the final frame has finished being displayed */
+bool sprite_animate(CTX_PARAMS const sprite_animation_t* animation)
+{
+    if (ctx->sprite.current_animation != animation) {
+        // Start the animation from the first frame
+        ctx->sprite.current_animation = animation;
+        ctx->sprite.current_frame = 0;
+        sprite_blit(CTX_ARGS &animation->frames[0]);
+        wheel_timer_start(CTX_ARGS WHEEL_TIMER_SPRITE_FRAME, animation->frame_ticks, 
+                          animation->frame_ticks, sprite_next_frame);
+        return false;
+    }
+
+    if (wheel_timer_running_p(CTX_ARGS WHEEL_TIMER_SPRITE_FRAME)) {
+        return false;
+    }
+
+    // Finished, clear the display so the next call restarts the animation
+    sprite_stop(CTX_ARG);
+    return true;
+}
+
+
+/** Stop the current animation and clear the display, so the next call to
+ *  sprite_animate starts from the first frame. */
+void sprite_stop(CTX_PARAM)
+{
+    ctx->sprite.current_animation = NULL;
+    wheel_timer_stop(CTX_ARGS WHEEL_TIMER_SPRITE_FRAME);
+    shade_clear(CTX_ARG);
+}
@@ -0,0 +1,60 @@
+/**
+  @file sprite.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Precomputed sprite animations for status messages. Frames are stored as column 
+         bitmaps in program memory and copied to the display only when the frame changes.
+ */
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include "system.h"
+#include "tinygl.h"
+#include "context.h"
+
+#define SPRITE_COLS 5
+#define SPRITE_ROWS 7
+#define SPRITE_NUM_SINK 3
+
+/* A single frame. Each byte is one display column, bit 0 being the top row. */
+typedef struct {
+    uint8_t columns[SPRITE_COLS];
+} sprite_frame_t;
+
+/* A sequence of frames, each shown for frame_ticks ticks of the paced loop, at most 
+   WHEEL_MAX_DELAY. */
+typedef struct {
+    const sprite_frame_t* frames;
+    uint8_t num_frames;
+    uint16_t frame_ticks;
+} sprite_animation_t;
+
+/* Animation state, part of game_context_t */
+typedef struct {
+    const sprite_animation_t* current_animation;
+    uint8_t current_frame;
+} sprite_context_t;
+
+extern const sprite_animation_t SPRITE_HIT;
+extern const sprite_animation_t SPRITE_MISS;
+extern const sprite_animation_t SPRITE_SINK[SPRITE_NUM_SINK];
+extern const sprite_animation_t SPRITE_WIN;
+extern const sprite_animation_t SPRITE_LOSS;
+extern const sprite_animation_t SPRITE_CHEAT;
+extern const sprite_animation_t SPRITE_WIN_UNVERIFIED;
+extern const sprite_animation_t SPRITE_LOSS_UNVERIFIED;
+extern const sprite_animation_t SPRITE_WAIT;
+
+
+/** Play an animation, one tick per call. The animation is started if it isn't already
+ *  the one playing, and the display is only written when the frame changes.
+    @param animation The animation to play
+    @return Whether the final frame has finished being displayed */
+bool sprite_animate(CTX_PARAMS const sprite_animation_t* animation);
+
+/** Stop the current animation and clear the display, so the next call to
+ *  sprite_animate starts from the first frame. */
+void sprite_stop(CTX_PARAM);
+
+#endif // SPRITE_H
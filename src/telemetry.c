@@ -0,0 +1,168 @@
+/**
+  @file telemetry.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Hidden diagnostics view, paging through the IR link statistics on the matrix.
+         Holding the navswitch down while waiting for the other player opens and closes it.
+ */
+
+#include "system.h"
+#include "tinygl.h"
+#include "navswitch.h"
+#include "communication.h"
+#include "input.h"
+#include "shade.h"
+#include "sprite.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "game_context.h"
+
+#define PAGE_ROW 0
+#define VALUE_ROW 2
+#define NIBBLE_BITS 4
+#define NIBBLE_ROWS 4
+#define PAGE_SHADE SHADE_DIM
+#define VALUE_SHADE SHADE_FULL
+
+typedef enum {
+    PAGE_REQUESTS = 0,
+    PAGE_RTT_LAST,
+    PAGE_RTT_MAX,
+    PAGE_RTT_MEAN,
+    PAGE_RETRANSMITS,
+    PAGE_RETRANSMITS_MAX,
+    PAGE_INVALID_BYTES,
+    PAGE_OUT_OF_PLACE_BYTES,
+    PAGE_BLOCKED_TICKS,
+    PAGE_INPUT_LATENCY_MAX,
+    PAGE_GOODPUT,
+    NUM_PAGES
+} TelemetryPage_t;
+
+/** Get the value shown on a page, saturated to 16 bits.
+    @param page_number The page
+    @return The value */
+static uint16_t page_value(CTX_PARAMS uint8_t page_number)
+{
+    link_stats_t stats;
+    input_latency_t latency;
+    uint32_t value = 0;
+    get_link_stats(CTX_ARGS &stats);
+    input_latency_get(CTX_ARGS &latency);
+
+    switch (page_number) {
+        case PAGE_REQUESTS:
+            value = stats.requests;
+            break;
+        case PAGE_RTT_LAST:
+            value = stats.rtt_last;
+            break;
+        case PAGE_RTT_MAX:
+            value = stats.rtt_max;
+            break;
+        case PAGE_RTT_MEAN:
+            value = stats.requests ? stats.rtt_total / stats.requests : 0;
+            break;
+        case PAGE_RETRANSMITS:
+            value = stats.retransmits;
+            break;
+        case PAGE_RETRANSMITS_MAX:
+            value = stats.retransmits_max;
+            break;
+        case PAGE_INVALID_BYTES:
+            value = stats.invalid_bytes;
+            break;
+        case PAGE_OUT_OF_PLACE_BYTES:
+            value = stats.out_of_place_bytes;
+            break;
+        case PAGE_BLOCKED_TICKS:
+            value = stats.blocked_ticks;
+            break;
+        case PAGE_INPUT_LATENCY_MAX:
+            value = latency.max;
+            break;
+        case PAGE_GOODPUT:
+            // Requests answered per LINK_GOODPUT_TICKS blocked waiting on the answers
+            if (stats.rtt_total) {
+                value = (uint32_t)stats.requests * LINK_GOODPUT_TICKS / stats.rtt_total;
+            }
+            break;
+        default:
+            break;
+    }
+    return value > UINT16_MAX ? UINT16_MAX : value;
+}
+
+
+/** Draw a row of bits, most significant on the left.
+    @param row The display row
+    @param bits The bits to draw
+    @param width Number of bits
+    @param level Brightness of the set bits */
+static void draw_bits(CTX_PARAMS uint8_t row, uint8_t bits, uint8_t width, shade_level_t level)
+{
+    for (uint8_t i = 0; i < width; i++) {
+        tinygl_point_t point = {width - 1 - i, row};
+        shade_draw_point(CTX_ARGS point, ((bits >> i) & 1) ? level : SHADE_OFF);
+    }
+}
+
+
+/** Draw the current page. The page number is shown dimly in binary on the top row, and
+ *  the value in binary below it, one hex digit per row with the most significant first. */
+static void draw_page(CTX_PARAM)
+{
+    uint16_t value = page_value(CTX_ARGS ctx->telemetry.page);
+
+    shade_clear(CTX_ARG);
+    draw_bits(CTX_ARGS PAGE_ROW, ctx->telemetry.page, TINYGL_WIDTH, PAGE_SHADE);
+    for (uint8_t i = 0; i < NIBBLE_ROWS; i++) {
+        uint8_t shift = NIBBLE_BITS * (NIBBLE_ROWS - 1 - i);
+        draw_bits(CTX_ARGS VALUE_ROW + i, (value >> shift) & 0x0F, NIBBLE_BITS, VALUE_SHADE);
+    }
+}
+
+
+/** Handle input for the telemetry view and draw the current page while it's open.
+ *  North and south change page, east exports the statistics over IR, and west dumps the
+ *  event trace in builds with TRACE enabled.
+    @return Whether the telemetry view is open */
+bool telemetry_update(CTX_PARAM)
+{
+    if (input_long_push_p(CTX_ARG)) {
+        ctx->telemetry.view_open = !ctx->telemetry.view_open;
+        sprite_stop(CTX_ARG); // Whatever was animating must be redrawn from scratch
+    }
+
+    if (!ctx->telemetry.view_open) {
+        return false;
+    }
+
+    if (input_event_p(CTX_ARGS NAVSWITCH_SOUTH)) {
+        ctx->telemetry.page = (ctx->telemetry.page + 1) % NUM_PAGES;
+    }
+    if (input_event_p(CTX_ARGS NAVSWITCH_NORTH)) {
+        ctx->telemetry.page = (ctx->telemetry.page + NUM_PAGES - 1) % NUM_PAGES;
+    }
+    if (input_event_p(CTX_ARGS NAVSWITCH_EAST)) {
+        export_link_stats(CTX_ARG);
+    }
+#if TRACE
+    if (input_event_p(CTX_ARGS NAVSWITCH_WEST)) {
+        trace_dump(CTX_ARG);
+    }
+#endif
+
+    draw_page(CTX_ARG);
+    return true;
+}
+
+
+/** Close the telemetry view, when leaving the state it was opened in. */
+void telemetry_close(CTX_PARAM)
+{
+    if (ctx->telemetry.view_open) {
+        ctx->telemetry.view_open = false;
+        shade_clear(CTX_ARG);
+    }
+}
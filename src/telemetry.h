@@ -0,0 +1,30 @@
+/**
+  @file telemetry.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Hidden diagnostics view, paging through the IR link statistics on the matrix.
+         Holding the navswitch down while waiting for the other player opens and closes it.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "system.h"
+#include "context.h"
+
+/* State of the telemetry view, part of game_context_t */
+typedef struct {
+    bool view_open;
+    uint8_t page;
+} telemetry_context_t;
+
+/** Handle input for the telemetry view and draw the current page while it's open.
+ *  North and south change page, east exports the statistics over IR, and west dumps the
+ *  event trace in builds with TRACE enabled.
+    @return Whether the telemetry view is open */
+bool telemetry_update(CTX_PARAM);
+
+/** Close the telemetry view, when leaving the state it was opened in. */
+void telemetry_close(CTX_PARAM);
+
+#endif // TELEMETRY_H
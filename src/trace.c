@@ -0,0 +1,38 @@
+/**
+  @file trace.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Timestamped trace of game events, logged into a ring buffer in RAM and dumped over
+         IR for tools/trace_decode.py to turn into a timeline. Build with "make TRACE=1" to
+         enable it, otherwise every trace point compiles out.
+ */
+
+#include "system.h"
+#include "trace.h"
+
+#if TRACE
+
+#include "ir_serial.h"
+#include "communication.h"
+#include "game_context.h"
+
+
+/** Send the trace to a listening host, oldest event first. The dump is TRACE_START, then the
+ *  number of events, then the fields of each trace_event_t in order, all as export packets
+ *  least significant nibble first. Nothing is acknowledged, and the other board ignores it. */
+void trace_dump(CTX_PARAM)
+{
+    uint8_t count = ctx->trace.count;
+    uint8_t first = (ctx->trace.next - count) & TRACE_EVENTS_MASK;
+
+    ir_serial_transmit(TRACE_START);
+    export_value(count, sizeof(count));
+    for (uint8_t i = 0; i < count; i++) {
+        trace_event_t* event = &ctx->trace.buffer[(first + i) & TRACE_EVENTS_MASK];
+        export_value(event->time, sizeof(event->time));
+        export_value(event->type, sizeof(event->type));
+        export_value(event->arg, sizeof(event->arg));
+    }
+}
+
+#endif // TRACE
@@ -0,0 +1,80 @@
+/**
+  @file trace.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Timestamped trace of game events, logged into a ring buffer in RAM and dumped over
+         IR for tools/trace_decode.py to turn into a timeline. Build with "make TRACE=1" to
+         enable it, otherwise every trace point compiles out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "system.h"
+
+#ifndef TRACE
+#define TRACE 0
+#endif
+
+// Number of events kept, must be a power of two
+#define TRACE_EVENTS 32
+#define TRACE_EVENTS_MASK (TRACE_EVENTS - 1)
+
+typedef enum {
+    TRACE_STATE = 1, // The GameState_t entered
+    TRACE_SENT, // The IR packet sent
+    TRACE_RECEIVED, // The IR packet received
+    TRACE_RECEIVE_ERROR, // The negated ir_serial_ret_t
+    TRACE_NAVSWITCH, // Events this tick, one bit per button
+    TRACE_OVERRUN // Timer ticks a game tick held up the next display scan by
+} TraceType_t;
+
+/* A traced event. The time is timer_get() when it was logged. */
+typedef struct {
+    uint16_t time;
+    uint8_t type;
+    uint8_t arg;
+} trace_event_t;
+
+#if TRACE
+
+#include "timer.h"
+#include "context.h"
+
+/* The trace, part of game_context_t */
+typedef struct {
+    trace_event_t buffer[TRACE_EVENTS];
+    uint8_t next;
+    uint8_t count;
+} trace_context_t;
+
+/** Log an event, overwriting the oldest once the buffer is full. This is inline so a trace
+ *  point costs only a few cycles.
+    @param trace The trace to log into
+    @param type The TraceType_t of the event
+    @param arg Detail of the event, see TraceType_t */
+static inline void trace_event(trace_context_t* trace, uint8_t type, uint8_t arg)
+{
+    trace_event_t* event = &trace->buffer[trace->next];
+    event->time = timer_get();
+    event->type = type;
+    event->arg = arg;
+    trace->next = (trace->next + 1) & TRACE_EVENTS_MASK;
+    if (trace->count < TRACE_EVENTS) {
+        trace->count++;
+    }
+}
+
+/** Send the trace to a listening host, oldest event first. */
+void trace_dump(CTX_PARAM);
+
+// Log into the trace of the context in scope
+#define TRACE_EVENT(type, arg) trace_event(&ctx->trace, (type), (arg))
+
+#else
+
+#define TRACE_EVENT(type, arg) do {} while (0)
+
+#endif // TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,247 @@
+/**
+  @file verify.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Commit-reveal verification of the opponents fleet. Each board commits to its layout
+         with a salted hash at the start of the game, and reveals the layout and salt at the
+         end so the other board can replay every shot against it.
+ */
+
+#include "system.h"
+#include "tinygl.h"
+#include "communication.h"
+#include "verify.h"
+#include "random.h"
+#include "game_context.h"
+
+#define HASH_C_ROUNDS 2
+#define HASH_D_ROUNDS 4
+#define HASH_KEY_CONSTANT 0x42415454 // Second half of the hash key, "BATT"
+
+static const uint8_t ship_lengths[NUM_SHIPS] = FLEET_SHIP_LENGTHS;
+
+/** Read a little endian 32 bit word.
+    @param bytes Pointer to the first byte
+    @return The word */
+static uint32_t read_word(const uint8_t* bytes)
+{
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) 
+           | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+/** One round of the HalfSipHash permutation.
+    @param v The four words of hash state */
+static void hash_round(uint32_t* v)
+{
+    v[0] += v[1]; v[1] = ROTL(v[1], 5);  v[1] ^= v[0]; v[0] = ROTL(v[0], 16);
+    v[2] += v[3]; v[3] = ROTL(v[3], 8);  v[3] ^= v[2];
+    v[0] += v[3]; v[3] = ROTL(v[3], 7);  v[3] ^= v[0];
+    v[2] += v[1]; v[1] = ROTL(v[1], 13); v[1] ^= v[2]; v[2] = ROTL(v[2], 16);
+}
+
+
+/** Hash a fleet layout with a salt using HalfSipHash-2-4, keyed by the salt. This only
+ *  uses 32 bit additions, rotations and xors, so takes well under a tick on the AVR.
+    @param salt Buffer of SALT_BYTES
+    @param layout Buffer of LAYOUT_BYTES
+    @param digest Buffer of COMMIT_BYTES to fill */
+static void hash_fleet(const uint8_t* salt, const uint8_t* layout, uint8_t* digest)
+{
+    uint32_t k0 = read_word(salt);
+    uint32_t k1 = HASH_KEY_CONSTANT;
+    uint32_t v[4] = {k0, k1, 0x6c796765 ^ k0, 0x74656462 ^ k1};
+
+    // The layout is shorter than a word, so it all goes in the final block with its length
+    uint32_t block = (uint32_t)LAYOUT_BYTES << 24;
+    for (uint8_t i = 0; i < LAYOUT_BYTES; i++) {
+        block |= (uint32_t)layout[i] << (8 * i);
+    }
+
+    v[3] ^= block;
+    for (uint8_t i = 0; i < HASH_C_ROUNDS; i++) {
+        hash_round(v);
+    }
+    v[0] ^= block;
+
+    v[2] ^= 0xFF;
+    for (uint8_t i = 0; i < HASH_D_ROUNDS; i++) {
+        hash_round(v);
+    }
+
+    uint32_t result = v[1] ^ v[3];
+    for (uint8_t i = 0; i < COMMIT_BYTES; i++) {
+        digest[i] = result >> (8 * i);
+    }
+}
+
+
+/** Encode this players fleet, choose a salt and compute the commitment to them.
+    @param starts Array of the first cell of each boat, in placement order
+    @param count Number of boats in the array */
+void verify_commit_fleet(CTX_PARAMS tinygl_point_t* starts, uint8_t count)
+{
+    // Boats are vertical with fixed lengths, so the first cell describes the whole boat
+    for (uint8_t i = 0; i < count; i++) {
+        ctx->verify.own_reveal[i] = (starts[i].x << X_SHIFT) | starts[i].y;
+    }
+    uint32_t salt = random_next(CTX_ARG);
+    for (uint8_t i = 0; i < SALT_BYTES; i++) {
+        ctx->verify.own_reveal[LAYOUT_BYTES + i] = salt >> (8 * i);
+    }
+    hash_fleet(&ctx->verify.own_reveal[LAYOUT_BYTES], ctx->verify.own_reveal, 
+               ctx->verify.own_commitment);
+}
+
+
+/** Get the commitment to this players fleet, to send to the opponent.
+    @param commitment Buffer of COMMIT_BYTES to fill */
+void verify_get_commitment(CTX_PARAMS uint8_t* commitment)
+{
+    for (uint8_t i = 0; i < COMMIT_BYTES; i++) {
+        commitment[i] = ctx->verify.own_commitment[i];
+    }
+}
+
+
+/** Get the layout and salt of this players fleet, to reveal at the end of the game.
+    @param reveal Buffer of REVEAL_BYTES to fill */
+void verify_get_reveal(CTX_PARAMS uint8_t* reveal)
+{
+    for (uint8_t i = 0; i < REVEAL_BYTES; i++) {
+        reveal[i] = ctx->verify.own_reveal[i];
+    }
+}
+
+
+/** Store the commitment received from the opponent at the start of the game.
+    @param commitment Buffer of COMMIT_BYTES */
+void verify_store_commitment(CTX_PARAMS const uint8_t* commitment)
+{
+    for (uint8_t i = 0; i < COMMIT_BYTES; i++) {
+        ctx->verify.opponent_commitment[i] = commitment[i];
+    }
+    ctx->verify.commitment_received = true;
+}
+
+
+/** Check whether the opponents commitment has arrived this game.
+    @return Whether it has */
+bool verify_commitment_received_p(CTX_PARAM)
+{
+    return ctx->verify.commitment_received;
+}
+
+
+/** Break the tie when both boards finish setup together, by comparing commitments. The two
+ *  boards compare the same pair of commitments, so exactly one goes first.
+    @return Whether this player attacks first */
+bool verify_goes_first_p(CTX_PARAM)
+{
+    // INIT_READY is only accepted once the commitment has arrived, so both boards have it
+    if (!ctx->verify.commitment_received) {
+        return false;
+    }
+    for (uint8_t i = 0; i < COMMIT_BYTES; i++) {
+        if (ctx->verify.own_commitment[i] != ctx->verify.opponent_commitment[i]) {
+            return ctx->verify.own_commitment[i] < ctx->verify.opponent_commitment[i];
+        }
+    }
+    return false; // Identical commitments are as unlikely as guessing the salt
+}
+
+
+/** Record the outcome of a shot at the opponent, to be replayed at the end of the game.
+    @param position The position that was fired at
+    @param hit Whether the opponent answered with a hit
+    @param sunk_ship The ship the opponent reported as sunk, or NO_SHIP */
+void verify_record_shot(CTX_PARAMS tinygl_point_t position, bool hit, uint8_t sunk_ship)
+{
+    ctx->verify.fired[position.x] |= (1 << position.y);
+    if (hit) {
+        ctx->verify.hits[position.x] |= (1 << position.y);
+    }
+    if (sunk_ship != NO_SHIP) {
+        ctx->verify.reported_sunk |= (1 << sunk_ship);
+        ctx->verify.reported_sinks++;
+    }
+}
+
+
+/** Record ships the opponent reported as sunk without saying which, as in a salvo.
+    @param count Number of ships sunk */
+void verify_record_sinks(CTX_PARAMS uint8_t count)
+{
+    ctx->verify.reported_sinks += count;
+}
+
+
+/** Check the opponents revealed fleet against their commitment, then replay every recorded
+ *  shot against it.
+    @param reveal Buffer of REVEAL_BYTES received from the opponent
+    @return VERIFY_HONEST if the opponent answered every shot honestly, VERIFY_CHEATED if
+            not, or VERIFY_UNVERIFIED if their commitment never arrived */
+VerifyResult_t verify_check_reveal(CTX_PARAMS const uint8_t* reveal)
+{
+    if (!ctx->verify.commitment_received) {
+        return VERIFY_UNVERIFIED;
+    }
+
+    uint8_t digest[COMMIT_BYTES];
+    hash_fleet(&reveal[LAYOUT_BYTES], reveal, digest);
+    for (uint8_t i = 0; i < COMMIT_BYTES; i++) {
+        if (digest[i] != ctx->verify.opponent_commitment[i]) {
+            return VERIFY_CHEATED; // The revealed layout isn't the one committed to
+        }
+    }
+
+    // Rebuild the opponents board, checking the layout is legal as we go
+    uint8_t occupied[NUM_COLS] = {0};
+    uint8_t sinks = 0;
+    for (uint8_t ship = 0; ship < NUM_SHIPS; ship++) {
+        uint8_t x = (reveal[ship] & X_BITMASK) >> X_SHIFT;
+        uint8_t y = reveal[ship] & Y_BITMASK;
+        if (x >= NUM_COLS || y + ship_lengths[ship] > NUM_OF_ROWS) {
+            return VERIFY_CHEATED;
+        }
+
+        uint8_t cells = ((1 << ship_lengths[ship]) - 1) << y;
+        if (occupied[x] & cells) {
+            return VERIFY_CHEATED;
+        }
+        occupied[x] |= cells;
+
+        // A ship reported sunk by name must have had all of its cells hit
+        bool sunk = (ctx->verify.fired[x] & cells) == cells;
+        if (!sunk && ((ctx->verify.reported_sunk >> ship) & 1)) {
+            return VERIFY_CHEATED;
+        }
+        sinks += sunk;
+    }
+
+    // Every ship that went down must have been reported, by name or in a salvo count
+    if (sinks != ctx->verify.reported_sinks) {
+        return VERIFY_CHEATED;
+    }
+
+    // Every shot must have been answered as a hit exactly when it landed on a ship
+    for (uint8_t x = 0; x < NUM_COLS; x++) {
+        if ((occupied[x] & ctx->verify.fired[x]) != ctx->verify.hits[x]) {
+            return VERIFY_CHEATED;
+        }
+    }
+    return VERIFY_HONEST;
+}
+
+
+/** Forget the recorded shots and the opponents commitment, ready for a new game. */
+void verify_reset(CTX_PARAM)
+{
+    for (uint8_t x = 0; x < NUM_COLS; x++) {
+        ctx->verify.fired[x] = 0;
+        ctx->verify.hits[x] = 0;
+    }
+    ctx->verify.reported_sunk = 0;
+    ctx->verify.reported_sinks = 0;
+    ctx->verify.commitment_received = false;
+}
@@ -0,0 +1,87 @@
+/**
+  @file verify.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Commit-reveal verification of the opponents fleet. Each board commits to its layout
+         with a salted hash at the start of the game, and reveals the layout and salt at the
+         end so the other board can replay every shot against it.
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "system.h"
+#include "tinygl.h"
+#include "communication.h"
+#include "context.h"
+
+#define COMMIT_BYTES 4
+#define SALT_BYTES 4
+#define LAYOUT_BYTES NUM_SHIPS
+#define REVEAL_BYTES (LAYOUT_BYTES + SALT_BYTES)
+
+#if STREAM_MAX_BYTES < REVEAL_BYTES
+#error "The stream buffer in communication.h must hold the fleet reveal"
+#endif
+
+/* Commitments and the shots to replay against the opponents reveal, part of game_context_t.
+   Shots are recorded one byte per column, bit 0 being the top row. */
+typedef struct {
+    uint8_t own_reveal[REVEAL_BYTES];
+    uint8_t own_commitment[COMMIT_BYTES];
+    uint8_t opponent_commitment[COMMIT_BYTES];
+    bool commitment_received;
+    uint8_t fired[NUM_COLS];
+    uint8_t hits[NUM_COLS];
+    uint8_t reported_sunk;
+    uint8_t reported_sinks;
+} verify_context_t;
+
+
+/** Encode this players fleet, choose a salt and compute the commitment to them.
+    @param starts Array of the first cell of each boat, in placement order
+    @param count Number of boats in the array */
+void verify_commit_fleet(CTX_PARAMS tinygl_point_t* starts, uint8_t count);
+
+/** Get the commitment to this players fleet, to send to the opponent.
+    @param commitment Buffer of COMMIT_BYTES to fill */
+void verify_get_commitment(CTX_PARAMS uint8_t* commitment);
+
+/** Get the layout and salt of this players fleet, to reveal at the end of the game.
+    @param reveal Buffer of REVEAL_BYTES to fill */
+void verify_get_reveal(CTX_PARAMS uint8_t* reveal);
+
+/** Store the commitment received from the opponent at the start of the game.
+    @param commitment Buffer of COMMIT_BYTES */
+void verify_store_commitment(CTX_PARAMS const uint8_t* commitment);
+
+/** Check whether the opponents commitment has arrived this game.
+    @return Whether it has */
+bool verify_commitment_received_p(CTX_PARAM);
+
+/** Break the tie when both boards finish setup together, by comparing commitments. The two
+ *  boards compare the same pair of commitments, so exactly one goes first.
+    @return Whether this player attacks first */
+bool verify_goes_first_p(CTX_PARAM);
+
+/** Record the outcome of a shot at the opponent, to be replayed at the end of the game.
+    @param position The position that was fired at
+    @param hit Whether the opponent answered with a hit
+    @param sunk_ship The ship the opponent reported as sunk, or NO_SHIP */
+void verify_record_shot(CTX_PARAMS tinygl_point_t position, bool hit, uint8_t sunk_ship);
+
+/** Record ships the opponent reported as sunk without saying which, as in a salvo.
+    @param count Number of ships sunk */
+void verify_record_sinks(CTX_PARAMS uint8_t count);
+
+/** Check the opponents revealed fleet against their commitment, then replay every recorded
+ *  shot against it.
+    @param reveal Buffer of REVEAL_BYTES received from the opponent
+    @return VERIFY_HONEST if the opponent answered every shot honestly, VERIFY_CHEATED if
+            not, or VERIFY_UNVERIFIED if their commitment never arrived */
+VerifyResult_t verify_check_reveal(CTX_PARAMS const uint8_t* reveal);
+
+/** Forget the recorded shots and the opponents commitment, ready for a new game. */
+void verify_reset(CTX_PARAM);
+
+#endif // VERIFY_H
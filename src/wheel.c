@@ -0,0 +1,138 @@
+/**
+  @file wheel.c
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Software timers driven by the paced loop, kept in a two level timer wheel. Each
+         tick only looks at the timers that could be due, so it costs the same however many
+         are running.
+ */
+
+#include "system.h"
+#include "wheel.h"
+#include "game_context.h"
+
+
+/** Add a running timer to the slot for its expiry.
+    @param timer The WheelTimer_t */
+static void wheel_link(CTX_PARAMS uint8_t timer)
+{
+    wheel_timer_t* entry = &ctx->wheel.timers[timer];
+    uint16_t delay = entry->expiry - ctx->wheel.now;
+
+    if (delay < WHEEL_SLOTS) {
+        entry->slot = entry->expiry & WHEEL_SLOT_MASK;
+    } else {
+        entry->slot = WHEEL_SLOTS + ((entry->expiry >> WHEEL_SLOT_BITS) & WHEEL_SLOT_MASK);
+    }
+
+    entry->prev = 0;
+    entry->next = ctx->wheel.slots[entry->slot];
+    if (entry->next) {
+        ctx->wheel.timers[entry->next - 1].prev = timer + 1;
+    }
+    ctx->wheel.slots[entry->slot] = timer + 1;
+    entry->running = true;
+}
+
+
+/** Remove a running timer from its slot.
+    @param timer The WheelTimer_t */
+static void wheel_unlink(CTX_PARAMS uint8_t timer)
+{
+    wheel_timer_t* entry = &ctx->wheel.timers[timer];
+
+    if (entry->prev) {
+        ctx->wheel.timers[entry->prev - 1].next = entry->next;
+    } else {
+        ctx->wheel.slots[entry->slot] = entry->next;
+    }
+    if (entry->next) {
+        ctx->wheel.timers[entry->next - 1].prev = entry->prev;
+    }
+    entry->running = false;
+}
+
+
+/** Limit a delay to what the wheel can hold.
+    @param delay The delay in ticks
+    @return The delay, from 1 to WHEEL_MAX_DELAY */
+static uint16_t wheel_clamp(uint16_t delay)
+{
+    if (delay == 0) {
+        return 1;
+    }
+    return delay > WHEEL_MAX_DELAY ? WHEEL_MAX_DELAY : delay;
+}
+
+
+/** Start a timer, restarting it if it is already running.
+    @param timer The WheelTimer_t to start
+    @param delay Ticks until it first expires, from 1 to WHEEL_MAX_DELAY
+    @param period Ticks between later expiries, up to WHEEL_MAX_DELAY, or 0 for a one-shot
+    @param callback Function to call when it expires, or NULL to only poll it */
+void wheel_timer_start(CTX_PARAMS uint8_t timer, uint16_t delay, uint16_t period, 
+                       wheel_callback_t callback)
+{
+    wheel_timer_t* entry = &ctx->wheel.timers[timer];
+
+    wheel_timer_stop(CTX_ARGS timer);
+    entry->expiry = ctx->wheel.now + wheel_clamp(delay);
+    entry->period = period ? wheel_clamp(period) : 0;
+    entry->callback = callback;
+    wheel_link(CTX_ARGS timer);
+}
+
+
+/** Stop a timer. Nothing happens if it isn't running.
+    @param timer The WheelTimer_t to stop */
+void wheel_timer_stop(CTX_PARAMS uint8_t timer)
+{
+    if (ctx->wheel.timers[timer].running) {
+        wheel_unlink(CTX_ARGS timer);
+    }
+}
+
+
+/** Check whether a timer is running. A one-shot timer stops when it expires.
+    @param timer The WheelTimer_t to check
+    @return Whether it is running */
+bool wheel_timer_running_p(CTX_PARAMS uint8_t timer)
+{
+    return ctx->wheel.timers[timer].running;
+}
+
+
+/** Advance the wheel by one tick, calling back every timer that expires. Must be called 
+ *  once per tick of the paced loop. */
+void wheel_update(CTX_PARAM)
+{
+    ctx->wheel.now++;
+    uint8_t tick = ctx->wheel.now & WHEEL_SLOT_MASK;
+
+    if (tick == 0) {
+        // Move the timers due in the next WHEEL_SLOTS ticks down to the first level. Each 
+        // timer moves at most once, so this is a fixed cost per timer rather than per tick.
+        uint8_t slot = WHEEL_SLOTS + ((ctx->wheel.now >> WHEEL_SLOT_BITS) & WHEEL_SLOT_MASK);
+        while (ctx->wheel.slots[slot]) {
+            uint8_t timer = ctx->wheel.slots[slot] - 1;
+            wheel_unlink(CTX_ARGS timer);
+            wheel_link(CTX_ARGS timer);
+        }
+    }
+
+    // Everything in this tick's slot expires now. A callback may start or stop timers, but
+    // none can land back in this slot, as every delay is at least one tick.
+    while (ctx->wheel.slots[tick]) {
+        uint8_t timer = ctx->wheel.slots[tick] - 1;
+        wheel_timer_t* entry = &ctx->wheel.timers[timer];
+
+        wheel_unlink(CTX_ARGS timer);
+        if (entry->period) {
+            entry->expiry += entry->period;
+            wheel_link(CTX_ARGS timer);
+        }
+        if (entry->callback) {
+            entry->callback(CTX_ARGS timer);
+        }
+    }
+}
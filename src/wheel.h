@@ -0,0 +1,82 @@
+/**
+  @file wheel.h
+  @author C. Varney, C. Horne
+  @date 18/10/2024
+  @brief Software timers driven by the paced loop, kept in a two level timer wheel. Each
+         tick only looks at the timers that could be due, so it costs the same however many
+         are running.
+ */
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include "system.h"
+#include "context.h"
+
+// Each level has this many slots, a power of two
+#define WHEEL_SLOT_BITS 5
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 2
+
+// The longest delay or period, in ticks of the paced loop
+#define WHEEL_MAX_DELAY (WHEEL_SLOTS * WHEEL_SLOTS - 1)
+
+/* Every timer, each owned by one module. */
+typedef enum {
+    WHEEL_TIMER_BOAT_FLASH = 0,
+    WHEEL_TIMER_CURSOR_FLASH,
+    WHEEL_TIMER_SALVO_SUMMARY,
+    WHEEL_TIMER_SPRITE_FRAME,
+    NUM_WHEEL_TIMERS
+} WheelTimer_t;
+
+/* Called when a timer expires, with the WheelTimer_t that expired. A periodic timer has
+   already been restarted, so it may be stopped from its own callback. */
+typedef void (*wheel_callback_t)(CTX_PARAMS uint8_t timer);
+
+/* A timer. next and prev link the timers in the same slot, as a timer index plus one, or
+   zero at either end of the list. */
+typedef struct {
+    wheel_callback_t callback;
+    uint16_t expiry;
+    uint16_t period;
+    uint8_t slot;
+    uint8_t next;
+    uint8_t prev;
+    bool running;
+} wheel_timer_t;
+
+/* Timer state, part of game_context_t. The first WHEEL_SLOTS slots hold timers due within
+   WHEEL_SLOTS ticks, one slot per tick. The rest hold later timers, one slot per WHEEL_SLOTS 
+   ticks, which move down to the first level as they come within range. Each slot is the 
+   first timer in it, as a timer index plus one, or zero if the slot is empty. */
+typedef struct {
+    uint8_t slots[WHEEL_LEVELS * WHEEL_SLOTS];
+    wheel_timer_t timers[NUM_WHEEL_TIMERS];
+    uint16_t now;
+} wheel_context_t;
+
+
+/** Start a timer, restarting it if it is already running.
+    @param timer The WheelTimer_t to start
+    @param delay Ticks until it first expires, from 1 to WHEEL_MAX_DELAY
+    @param period Ticks between later expiries, up to WHEEL_MAX_DELAY, or 0 for a one-shot
+    @param callback Function to call when it expires, or NULL to only poll it */
+void wheel_timer_start(CTX_PARAMS uint8_t timer, uint16_t delay, uint16_t period, 
+                       wheel_callback_t callback);
+
+/** Stop a timer. Nothing happens if it isn't running.
+    @param timer The WheelTimer_t to stop */
+void wheel_timer_stop(CTX_PARAMS uint8_t timer);
+
+/** Check whether a timer is running. A one-shot timer stops when it expires.
+    @param timer The WheelTimer_t to check
+    @return Whether it is running */
+bool wheel_timer_running_p(CTX_PARAMS uint8_t timer);
+
+/** Advance the wheel by one tick, calling back every timer that expires. Must be called 
+ *  once per tick of the paced loop. */
+void wheel_update(CTX_PARAM);
+
+#endif // WHEEL_H
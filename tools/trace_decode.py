@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Decode an event trace dumped over IR by a UCFK4 Battleships board into a timeline.
+
+Build the game with "make TRACE=1", open the telemetry view while waiting for the other
+player and push the navswitch west to dump the trace. Capture the IR bytes on the host, for
+example with a board relaying them to a serial port, then run:
+
+    trace_decode.py capture.bin          # raw bytes
+    trace_decode.py --hex capture.txt    # bytes as whitespace separated hex
+
+The dump format is described in src/trace.c and src/communication.h.
+"""
+
+import argparse
+import sys
+
+TRACE_START = 0x71
+EXPORT_HEADER = 0x60
+EXPORT_HEADER_MASK = 0xF0
+NIBBLE_MASK = 0x0F
+
+# F_CPU / 1024 at the UCFK4's 8MHz clock, the rate of timer_get()
+TIMER_RATE = 8000000 / 1024
+TIMER_WRAP = 1 << 16
+
+# TraceType_t and GameState_t, from src/trace.h and src/gamestate.h
+TRACE_TYPES = {
+    1: "state",
+    2: "sent",
+    3: "received",
+    4: "receive error",
+    5: "navswitch",
+    6: "overrun",
+}
+GAME_STATES = ["SETUP", "ATTACK", "WAIT", "HIT", "MISS", "SUNK", "SALVO", "WIN", "LOSS"]
+ATTACK = GAME_STATES.index("ATTACK")
+BUTTONS = ["NORTH", "EAST", "SOUTH", "WEST", "PUSH"]
+
+# PredefinedMessages_t, from src/communication.h
+PACKETS = {
+    0xFF: "HIT",
+    0x80: "MISS",
+    0x7F: "INIT_READY",
+    0xBF: "INIT_READY_ACK",
+    0xBE: "INIT_READY_RESEND",
+    0xBC: "INIT_READY_WAITING",
+    0xBD: "SALVO_RESEND",
+    0x70: "EXPORT_START",
+    0x71: "TRACE_START",
+}
+
+
+def describe_packet(packet):
+    """Name a packet of the game protocol."""
+    if packet in PACKETS:
+        return PACKETS[packet]
+    if packet & 0xF8 == 0x78 and packet & 0x03 != 0x03:
+        return "SALVO_FIRE seq=%d targets=%d" % ((packet >> 2) & 1, (packet & 0x03) + 1)
+    if packet >> 6 == 0:
+        return "request x=%d y=%d" % ((packet >> 3) & 0x07, packet & 0x07)
+    if packet & 0xE0 == 0x40:
+        return "DATA seq=%d nibble=0x%x" % ((packet >> 4) & 1, packet & 0x0F)
+    if packet & 0xFE == 0xA0:
+        return "DATA_ACK seq=%d" % (packet & 1)
+    if packet & 0xF8 == 0xC0:
+        return "SUNK ship=%d" % (packet & 0x07)
+    if packet & 0xE0 == 0xE0:
+        return "SALVO_RESULT hits=0x%x sunk=%d" % (packet & 0x07, (packet >> 3) & 0x03)
+    if packet & 0xF0 == 0x60:
+        return "EXPORT nibble=0x%x" % (packet & 0x0F)
+    return "unknown"
+
+
+def describe_event(kind, arg):
+    """Describe the argument of an event."""
+    name = TRACE_TYPES.get(kind, "type %d" % kind)
+    if kind == 1:
+        detail = GAME_STATES[arg] if arg < len(GAME_STATES) else str(arg)
+    elif kind in (2, 3):
+        detail = "0x%02x %s" % (arg, describe_packet(arg))
+    elif kind == 4:
+        detail = "ir_serial error %d" % -arg
+    elif kind == 5:
+        detail = " ".join(b for i, b in enumerate(BUTTONS) if arg & (1 << i))
+    elif kind == 6:
+        detail = "%.1f ms late" % (arg * 1000 / TIMER_RATE)
+    else:
+        detail = str(arg)
+    return "%-14s %s" % (name, detail)
+
+
+def find_dumps(data):
+    """Yield the nibbles of each dump in a capture. The other board's traffic may be mixed
+    in, so anything that isn't an export packet is skipped."""
+    nibbles = None
+    for byte in data:
+        if byte == TRACE_START:
+            if nibbles is not None:
+                yield nibbles
+            nibbles = []
+        elif nibbles is not None and byte & EXPORT_HEADER_MASK == EXPORT_HEADER:
+            nibbles.append(byte & NIBBLE_MASK)
+    if nibbles is not None:
+        yield nibbles
+
+
+def read_value(nibbles, pos, size):
+    """Read a little endian value of size bytes, least significant nibble first."""
+    value = 0
+    for i in range(2 * size):
+        value |= nibbles[pos + i] << (4 * i)
+    return value, pos + 2 * size
+
+
+def decode(nibbles):
+    """Decode a dump into (time in ms, type, argument) tuples, oldest first."""
+    if len(nibbles) < 2:
+        return []
+    count, pos = read_value(nibbles, 0, 1)
+    events = []
+    last_time = None
+    elapsed = 0
+    for _ in range(count):
+        if pos + 8 > len(nibbles):
+            print("warning: dump truncated after %d of %d events" % (len(events), count),
+                  file=sys.stderr)
+            break
+        time, pos = read_value(nibbles, pos, 2)
+        kind, pos = read_value(nibbles, pos, 1)
+        arg, pos = read_value(nibbles, pos, 1)
+
+        # timer_get() wraps every 8 seconds, assume events are closer together than that
+        if last_time is not None:
+            elapsed += (time - last_time) % TIMER_WRAP
+        last_time = time
+        events.append((elapsed * 1000 / TIMER_RATE, kind, arg))
+    return events
+
+
+def turn_cycle(events):
+    """Mean time in ms between the starts of our turns, or None if there aren't two."""
+    starts = [time for time, kind, arg in events if kind == 1 and arg == ATTACK]
+    if len(starts) < 2:
+        return None
+    return (starts[-1] - starts[0]) / (len(starts) - 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="captured IR bytes, stdin if omitted")
+    parser.add_argument("--hex", action="store_true", help="capture is hex text")
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, "rb") as f:
+            raw = f.read()
+    else:
+        raw = sys.stdin.buffer.read()
+    data = bytes(int(b, 16) for b in raw.split()) if args.hex else raw
+
+    for number, nibbles in enumerate(find_dumps(data)):
+        print("dump %d" % number)
+        events = decode(nibbles)
+        for time, kind, arg in events:
+            print("%10.1f ms  %s" % (time, describe_event(kind, arg)))
+        cycle = turn_cycle(events)
+        if cycle is not None:
+            print("mean turn cycle %.1f ms" % cycle)
+
+
+if __name__ == "__main__":
+    main()